@@ -0,0 +1,176 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Steady state allocation check. Runs a list of short insert and delete cycles
+//over every corpus to warm up, then a second list with other positions and
+//lengths while counting heap allocations. Exits with 1 if any insert allocated.
+//The warm up is ALLOC_WARMUP_ROUNDS times longer so the pools and caches that
+//grow with the text settle, the measured list comes from another seed.
+//Usage: TextEngineAllocBench [font_dir] [edits]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "BenchUtils.h"
+#include "TextEngine.h"
+
+//Inserts type 1 to ALLOC_BURST_MAX characters
+#define ALLOC_BURST_MAX		4
+#define ALLOC_WARMUP_ROUNDS	4
+#define ALLOC_WARMUP_SEED	0x9E3779B97F4A7C15ULL
+#define ALLOC_MEASURE_SEED	0xD1B54A32D192ED03ULL
+
+uint64_t heap_allocs = 0;
+
+#if defined(__GLIBC__)
+//Counts every allocation of the process, HarfBuzz and libstdc++ included
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t num, size_t size);
+	void* __libc_realloc(void* mem, size_t size);
+	void __libc_free(void* mem);
+
+	void* malloc(size_t size) {
+		++heap_allocs;
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t num, size_t size) {
+		++heap_allocs;
+		return __libc_calloc(num, size);
+	}
+
+	void* realloc(void* mem, size_t size) {
+		++heap_allocs;
+		return __libc_realloc(mem, size);
+	}
+
+	void free(void* mem) {
+		__libc_free(mem);
+	}
+}
+#define COUNTS_LIBC true
+#else
+//Only operator new is visible, the engine's own hooks are added on top
+void* operator new(size_t size) {
+	++heap_allocs;
+	void* ret = malloc(size);
+	if (ret == nullptr)
+		throw std::bad_alloc();
+	return ret;
+}
+
+void operator delete(void* mem) noexcept {
+	free(mem);
+}
+#define COUNTS_LIBC false
+#endif
+
+
+uint64_t CountHeapAllocs() {
+	if (COUNTS_LIBC)
+		return heap_allocs;
+	return heap_allocs + MemoryGetHeapAllocCount();
+}
+
+
+struct AllocEdit {
+	size_t paragraph;
+	size_t cp;
+	size_t len;
+};
+
+
+void BuildAllocEdits(TextEngine& te, size_t edits, uint64_t seed, std::vector<AllocEdit>& list) {
+	BenchRandom rand(seed);
+	list.resize(edits);
+	for (size_t i = 0;i < edits;++i) {
+		list[i].paragraph = rand.Below(te.GetParagarphNum());
+		list[i].cp = rand.Below(te.GetParagraph(list[i].paragraph)->cps.GetSize() + 1);
+		list[i].len = rand.Below(ALLOC_BURST_MAX) + 1;
+	}
+}
+
+
+//Returns the number of inserts that allocated
+size_t BenchAllocs(FontCollection* ff, const BenchCorpus& corpus, size_t edits) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	std::string burst;
+	for (int i = 0;i < ALLOC_BURST_MAX;++i)
+		burst += corpus.insert_text;
+	size_t char_len = strlen(corpus.insert_text);
+
+	std::vector<AllocEdit> lists[2];
+	BuildAllocEdits(te, edits * ALLOC_WARMUP_ROUNDS, ALLOC_WARMUP_SEED, lists[0]);
+	BuildAllocEdits(te, edits, ALLOC_MEASURE_SEED, lists[1]);
+
+	uint64_t insert_allocs = 0;
+	uint64_t insert_max = 0;
+	uint64_t delete_allocs = 0;
+	uint64_t hook_allocs = 0;
+	size_t failed = 0;
+	//Every cycle restores the text, only the positions and lengths differ between passes
+	for (int pass = 0;pass < 2;++pass) {
+		const std::vector<AllocEdit>& list = lists[pass];
+		for (size_t i = 0;i < list.size();++i) {
+			CPPos pos(list[i].paragraph, list[i].cp);
+			uint64_t h0 = MemoryGetHeapAllocCount();
+			uint64_t a0 = CountHeapAllocs();
+			CPPos end = te.Insert(burst.c_str(), char_len * list[i].len, pos);
+			uint64_t a1 = CountHeapAllocs();
+			uint64_t h1 = MemoryGetHeapAllocCount();
+			te.Delete(pos, end);
+			uint64_t a2 = CountHeapAllocs();
+			if (pass == 0)
+				continue;
+			insert_allocs += a1 - a0;
+			delete_allocs += a2 - a1;
+			hook_allocs += h1 - h0;
+			if (a1 - a0 > insert_max)
+				insert_max = a1 - a0;
+			if (a1 != a0)
+				++failed;
+		}
+	}
+	printf(
+		"%-8s %8zu %10.3f %10llu %10.3f %10.3f %8zu\n",
+		corpus.name, edits,
+		edits == 0 ? 0 : static_cast<double>(insert_allocs) / edits,
+		static_cast<unsigned long long>(insert_max),
+		edits == 0 ? 0 : static_cast<double>(hook_allocs) / edits,
+		edits == 0 ? 0 : static_cast<double>(delete_allocs) / edits,
+		failed
+	);
+	te.Clear();
+	return failed;
+}
+
+
+int main(int argc, char** argv) {
+	const char* font_dir = argc > 1 ? argv[1] : BENCH_FONT_DIR;
+	size_t edits = argc > 2 ? strtoul(argv[2], nullptr, 10) : 256;
+
+	BenchEnv env;
+	if (!env.Init(font_dir))
+		return 1;
+	std::vector<BenchCorpus> corpus;
+	BuildBenchCorpus(corpus);
+
+	if (!COUNTS_LIBC)
+		printf("libc allocations are not visible on this platform, counting operator new and engine hooks\n");
+	printf(
+		"%-8s %8s %10s %10s %10s %10s %8s\n",
+		"corpus", "edits", "ins/edit", "ins max", "hooks/edit", "del/edit", "failed"
+	);
+	size_t failed = 0;
+	for (size_t i = 0;i < corpus.size();++i)
+		failed += BenchAllocs(env.GetFontCollection(), corpus[i], edits);
+	if (failed > 0) {
+		printf("%zu short inserts allocated after warm up\n", failed);
+		return 1;
+	}
+	return 0;
+}
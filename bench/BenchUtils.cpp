@@ -0,0 +1,253 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "BenchUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <LineBreaker.h>
+
+
+uint64_t BenchNowNs() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count());
+}
+
+
+size_t CountUtf8Codepoints(const char* utf8_str, size_t len) {
+	size_t ret = 0;
+	for (size_t i = 0;i < len;++i)
+		if ((static_cast<unsigned char>(utf8_str[i]) & 0xC0U) != 0x80U)
+			++ret;
+	return ret;
+}
+
+
+uint32_t BenchRandom::Next() {
+	this->state ^= this->state >> 12;
+	this->state ^= this->state << 25;
+	this->state ^= this->state >> 27;
+	return static_cast<uint32_t>((this->state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+void LatencySamples::Add(uint64_t ns, size_t cps) {
+	this->samples.push_back(ns);
+	this->total_ns += ns;
+	this->total_cps += cps;
+	this->sorted = false;
+}
+
+
+void LatencySamples::Clear() {
+	this->samples.clear();
+	this->total_ns = 0;
+	this->total_cps = 0;
+	this->sorted = true;
+}
+
+
+double LatencySamples::CodepointsPerSecond() const {
+	if (this->total_ns == 0)
+		return 0;
+	return static_cast<double>(this->total_cps) * 1e9 / static_cast<double>(this->total_ns);
+}
+
+
+uint64_t LatencySamples::Percentile(double p) {
+	if (this->samples.empty())
+		return 0;
+	if (!this->sorted) {
+		std::sort(this->samples.begin(), this->samples.end());
+		this->sorted = true;
+	}
+	size_t rank = static_cast<size_t>(p / 100 * (this->samples.size() - 1) + 0.5);
+	return this->samples[rank];
+}
+
+
+uint64_t LatencySamples::Max() {
+	return this->Percentile(100);
+}
+
+
+std::string RepeatToLength(const char* unit, size_t min_bytes) {
+	std::string ret;
+	while (ret.size() < min_bytes)
+		ret += unit;
+	return ret;
+}
+
+
+std::string JoinParagraphs(const std::string& paragraph, size_t num) {
+	std::string ret;
+	for (size_t i = 0;i < num;++i) {
+		if (i > 0)
+			ret += '\n';
+		ret += paragraph;
+	}
+	return ret;
+}
+
+
+void BuildBenchCorpus(std::vector<BenchCorpus>& corpus) {
+	const char* latin = u8"The quick brown fox jumps over the lazy dog while the typesetter measures every glyph twice. ";
+	const char* arabic = u8"النص العربي يكتب من اليمين إلى اليسار ويحتاج إلى تشكيل الحروف حسب موقعها في الكلمة. ";
+	const char* bidi = u8"The title is مفتاح معايير الويب in Arabic, and 2025 stays left to right. ";
+
+	corpus.push_back({ "latin", JoinParagraphs(RepeatToLength(latin, 2048), 8), "e" });
+	corpus.push_back({ "arabic", JoinParagraphs(RepeatToLength(arabic, 2048), 8), u8"ب" });
+	corpus.push_back({ "bidi", JoinParagraphs(RepeatToLength(bidi, 2048), 8), u8"ع" });
+	//One long paragraph without any line break opportunity, forces the emergency break path
+	corpus.push_back({ "nobreak", RepeatToLength("abcdefghijklmnopqrstuvwxyz", 4096), "x" });
+}
+
+
+uint8_t* BenchLoadFile(const char* path, size_t* size) {
+	FILE* fp = fopen(path, "rb");
+	size_t file_size;
+	uint8_t* buffer;
+	if (!fp)
+		goto open_fail;
+	fseek(fp, 0, SEEK_END);
+	file_size = ftell(fp);
+	if (file_size == 0)
+		goto read_fail;
+	buffer = new uint8_t[file_size];
+	fseek(fp, 0, SEEK_SET);
+	if (fread(buffer, file_size, 1, fp) != 1) {
+		delete[] buffer;
+		goto read_fail;
+	}
+	fclose(fp);
+	*size = file_size;
+	return buffer;
+
+read_fail:
+	fclose(fp);
+open_fail:
+	*size = 0;
+	return nullptr;
+}
+
+
+const char* bench_font_files[] = {
+	"special_elite.ttf",
+	"NotoSansArabic-Regular.ttf",
+};
+
+
+bool BenchEnv::Init(const char* font_dir, uint32_t pixel_height, bool use_sdf) {
+	if (FT_Init_FreeType(&this->ftl)) {
+		this->ftl = nullptr;
+		return false;
+	}
+	LineBreakInit();
+	this->ff = new FontCollection(this->ftl, pixel_height, use_sdf);
+	for (size_t i = 0;i < sizeof(bench_font_files) / sizeof(bench_font_files[0]);++i) {
+		std::string path = std::string(font_dir) + "/" + bench_font_files[i];
+		size_t size;
+		uint8_t* buffer = BenchLoadFile(path.c_str(), &size);
+		if (buffer == nullptr) {
+			printf("Failed to load font %s\n", path.c_str());
+			return false;
+		}
+		this->font_buffers.push_back(buffer);
+		if (this->ff->AddFont(buffer, size) == nullptr) {
+			printf("Failed to add font %s\n", path.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void BenchEnv::Release() {
+	if (this->ff != nullptr) {
+		delete this->ff;
+		this->ff = nullptr;
+	}
+	for (size_t i = 0;i < this->font_buffers.size();++i)
+		delete[] this->font_buffers[i];
+	this->font_buffers.clear();
+	if (this->ftl != nullptr) {
+		LineBreakExit();
+		FT_Done_FreeType(this->ftl);
+		this->ftl = nullptr;
+	}
+}
+
+
+void PrintMemoryStats(const char* owner, const MemoryStats& stats) {
+	for (int i = 0;i < MEMORY_CATEGORY_NUM;++i) {
+		const MemoryCategoryStats& c = stats.categories[i];
+		if (c.peak == 0)
+			continue;
+		printf(
+			"%-12s %-12s reserved=%10.1fKB used=%10.1fKB peak=%10.1fKB blocks=%zu\n",
+			owner, MemoryCategoryName(i),
+			c.reserved / 1024.0, c.used / 1024.0, c.peak / 1024.0, c.blocks
+		);
+	}
+	printf(
+		"%-12s %-12s reserved=%10.1fKB used=%10.1fKB\n",
+		owner, "total",
+		stats.GetTotalReserved() / 1024.0, stats.GetTotalUsed() / 1024.0
+	);
+	if (stats.pooled > 0 || stats.arena > 0)
+		printf("%-12s %-12s pooled=%10.1fKB arena=%10.1fKB\n", owner, "allocators", stats.pooled / 1024.0, stats.arena / 1024.0);
+}
+
+
+void PrintLatencyHeader() {
+	printf("%-10s %-22s %8s %14s %12s %12s %12s\n", "corpus", "operation", "ops", "cps/sec", "p50(us)", "p99(us)", "max(us)");
+}
+
+
+void PrintLatencyRow(const char* corpus, const char* op, LatencySamples& samples) {
+	printf(
+		"%-10s %-22s %8zu %14.0f %12.2f %12.2f %12.2f\n",
+		corpus, op,
+		samples.GetCount(),
+		samples.CodepointsPerSecond(),
+		samples.Percentile(50) / 1000.0,
+		samples.Percentile(99) / 1000.0,
+		samples.Max() / 1000.0
+	);
+}
+
+
+#define BENCH_HISTOGRAM_BUCKETS 32
+#define BENCH_HISTOGRAM_BAR 50
+
+void PrintLatencyHistogram(const LatencySamples& samples) {
+	size_t buckets[BENCH_HISTOGRAM_BUCKETS] = {};
+	size_t count = samples.GetCount();
+	if (count == 0)
+		return;
+	for (size_t i = 0;i < count;++i) {
+		uint64_t us = samples.GetSample(i) / 1000;
+		int bucket = 0;
+		while (us != 0 && bucket < BENCH_HISTOGRAM_BUCKETS - 1) {
+			us >>= 1;
+			++bucket;
+		}
+		++buckets[bucket];
+	}
+	size_t most = 0;
+	for (int i = 0;i < BENCH_HISTOGRAM_BUCKETS;++i)
+		most = std::max(most, buckets[i]);
+	for (int i = 0;i < BENCH_HISTOGRAM_BUCKETS;++i) {
+		if (buckets[i] == 0)
+			continue;
+		//Bucket i holds [2^(i-1), 2^i) us, bucket 0 everything under 1us
+		unsigned long long low = i == 0 ? 0 : 1ULL << (i - 1);
+		unsigned long long high = 1ULL << i;
+		printf("%10llu - %-10llu us %8zu %6.2f%% ", low, high, buckets[i], buckets[i] * 100.0 / count);
+		size_t bar = (buckets[i] * BENCH_HISTOGRAM_BAR + most - 1) / most;
+		for (size_t j = 0;j < bar;++j)
+			putchar('#');
+		putchar('\n');
+	}
+}
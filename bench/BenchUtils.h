@@ -0,0 +1,99 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "FontCollection.h"
+
+#define BENCH_FONT_SIZE 32
+#define BENCH_WARP_WIDTH 640
+
+uint64_t BenchNowNs();
+size_t CountUtf8Codepoints(const char* utf8_str, size_t len);
+
+
+//Deterministic generator so that every run edits the same positions
+class BenchRandom {
+	uint64_t state;
+
+public:
+	BenchRandom(uint64_t seed = 0x9E3779B97F4A7C15ULL) :state(seed) {}
+	uint32_t Next();
+	size_t Below(size_t bound) {
+		return bound == 0 ? 0 : this->Next() % bound;
+	}
+};
+
+
+class LatencySamples {
+	std::vector<uint64_t> samples;
+	uint64_t total_ns = 0;
+	uint64_t total_cps = 0;
+	bool sorted = true;
+
+public:
+	void Add(uint64_t ns, size_t cps);
+	void Clear();
+	size_t GetCount() const {
+		return this->samples.size();
+	}
+	uint64_t GetSample(size_t i) const {
+		return this->samples[i];
+	}
+	uint64_t GetTotalNs() const {
+		return this->total_ns;
+	}
+	uint64_t GetTotalCodepoints() const {
+		return this->total_cps;
+	}
+	double CodepointsPerSecond() const;
+	uint64_t Percentile(double p);
+	uint64_t Max();
+};
+
+
+struct BenchCorpus {
+	const char* name;
+	std::string text;
+	const char* insert_text;
+};
+
+void BuildBenchCorpus(std::vector<BenchCorpus>& corpus);
+
+
+class BenchEnv {
+	FT_Library ftl = nullptr;
+	FontCollection* ff = nullptr;
+	std::vector<uint8_t*> font_buffers;
+
+public:
+	bool Init(const char* font_dir, uint32_t pixel_height = BENCH_FONT_SIZE, bool use_sdf = false);
+	FontCollection* GetFontCollection() {
+		return this->ff;
+	}
+	FT_Library GetFTLibrary() {
+		return this->ftl;
+	}
+	void Release();
+	~BenchEnv() {
+		this->Release();
+	}
+};
+
+
+uint8_t* BenchLoadFile(const char* path, size_t* size);
+void PrintLatencyHeader();
+void PrintLatencyRow(const char* corpus, const char* op, LatencySamples& samples);
+//Power of two buckets in microseconds, one bar per non-empty bucket
+void PrintLatencyHistogram(const LatencySamples& samples);
+//Prints the categories that ever reserved any bytes
+void PrintMemoryStats(const char* owner, const MemoryStats& stats);
+
+#endif
@@ -0,0 +1,239 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Complexity cliff detector. Generates pathological inputs at doubling sizes,
+//times TextEngine::Append, a single character TextEngine::Insert and
+//Paragraph::SloveLayout of the whole text, and fits the growth exponent of
+//each. Exits with 1 if any operation grows faster than linearly.
+//Usage: TextEngineCliffBench [font_dir] [max_size]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "BenchUtils.h"
+#include "TextEngine.h"
+#include "UTF8Codec.h"
+
+#define CLIFF_MIN_SIZE		256
+//Least squares slope of log(time) over log(size) above which a row is flagged
+#define CLIFF_EXPONENT		1.4
+//Measurements shorter than this are repeated, the fastest run is kept
+#define CLIFF_MIN_NS		20000000ULL
+#define CLIFF_MAX_REPEAT	16
+#define CLIFF_INSERT_REPEAT	15
+#define CLIFF_MAX_DEPTH		60
+
+#define CLIFF_OP_APPEND		0
+#define CLIFF_OP_INSERT		1
+#define CLIFF_OP_LAYOUT		2
+#define CLIFF_OP_NUM		3
+
+const char* cliff_op_names[CLIFF_OP_NUM] = {
+	"TextEngine::Append",
+	"TextEngine::Insert",
+	"Paragraph::SloveLayout",
+};
+
+
+void AppendCodepoint(std::string& str, uint32_t codepoint) {
+	unsigned char utf8[4];
+	int nb = UTF8Encode(codepoint, utf8);
+	str.append(reinterpret_cast<const char*>(utf8), nb);
+}
+
+
+//One paragraph with no break opportunity, every line takes the emergency break
+void GenerateNoBreak(size_t n, std::string& text) {
+	for (size_t i = 0;i < n;++i)
+		text += static_cast<char>('a' + i % 26);
+}
+
+
+//Every codepoint changes script, so SplitByScript emits one segment each
+void GenerateScripts(size_t n, std::string& text) {
+	const uint32_t cycle[] = { 'a', 0x0628, '1', 0x03B1, 0x0434, 0x4E2D, 0x05D0, 0x0E01 };
+	for (size_t i = 0;i < n;++i)
+		AppendCodepoint(text, cycle[i % (sizeof(cycle) / sizeof(cycle[0]))]);
+}
+
+
+//Isolates nested CLIFF_MAX_DEPTH deep, alternating direction at every level
+void GenerateNestedBidi(size_t n, std::string& text) {
+	size_t i = 0;
+	size_t depth = 0;
+	bool closing = false;
+	while (i < n) {
+		if (!closing && depth < CLIFF_MAX_DEPTH) {
+			AppendCodepoint(text, depth % 2 == 0 ? 0x2067 : 0x2066);
+			if (depth % 2 == 0)
+				AppendCodepoint(text, 0x0628);
+			else
+				text += 'a';
+			++depth;
+			i += 2;
+		}
+		else if (depth > 0) {
+			closing = true;
+			AppendCodepoint(text, 0x2069);
+			--depth;
+			++i;
+		}
+		else
+			closing = false;
+	}
+}
+
+
+//One character paragraphs
+void GenerateParagraphs(size_t n, std::string& text) {
+	for (size_t i = 0;i < n;++i) {
+		if (i > 0)
+			text += '\n';
+		text += static_cast<char>('a' + i % 26);
+	}
+}
+
+
+struct CliffCase {
+	const char* name;
+	void (*generate)(size_t n, std::string& text);
+	const char* insert_text;
+};
+
+
+//Fastest of a few runs, repeated until CLIFF_MIN_NS has been spent
+template<typename F>
+uint64_t MeasureMin(F run) {
+	uint64_t best = UINT64_MAX;
+	uint64_t total = 0;
+	for (int r = 0;r < CLIFF_MAX_REPEAT && (r < 3 || total < CLIFF_MIN_NS);++r) {
+		uint64_t ns = run();
+		total += ns;
+		if (ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+
+size_t LargestParagraph(TextEngine& te) {
+	size_t ret = 0;
+	for (size_t p = 1;p < te.GetParagarphNum();++p)
+		if (te.GetParagraph(p)->cps.GetSize() > te.GetParagraph(ret)->cps.GetSize())
+			ret = p;
+	return ret;
+}
+
+
+void MeasureCase(FontCollection* ff, const CliffCase& c, size_t n, uint64_t ns[CLIFF_OP_NUM]) {
+	std::string text;
+	c.generate(n, text);
+
+	ns[CLIFF_OP_APPEND] = MeasureMin([&]() {
+		TextEngine te(ff, BENCH_WARP_WIDTH);
+		uint64_t t0 = BenchNowNs();
+		te.Append(text.c_str(), text.size());
+		return BenchNowNs() - t0;
+	});
+
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(text.c_str(), text.size());
+	//Middle of the largest paragraph, or the middle paragraph when all are equal
+	size_t p = LargestParagraph(te);
+	if (te.GetParagraph(p)->cps.GetSize() <= 1)
+		p = te.GetParagarphNum() / 2;
+	CPPos pos(p, te.GetParagraph(p)->cps.GetSize() / 2);
+	size_t len = strlen(c.insert_text);
+	std::vector<uint64_t> samples;
+	for (int r = 0;r < CLIFF_INSERT_REPEAT;++r) {
+		uint64_t t0 = BenchNowNs();
+		CPPos end = te.Insert(c.insert_text, len, pos);
+		samples.push_back(BenchNowNs() - t0);
+		te.Delete(pos, end);
+	}
+	std::sort(samples.begin(), samples.end());
+	ns[CLIFF_OP_INSERT] = samples[samples.size() / 2];
+
+	ns[CLIFF_OP_LAYOUT] = MeasureMin([&]() {
+		uint64_t t0 = BenchNowNs();
+		for (size_t i = 0;i < te.GetParagarphNum();++i)
+			te.GetParagraph(i)->SloveLayout();
+		return BenchNowNs() - t0;
+	});
+	te.Clear();
+}
+
+
+//Least squares slope of log(ns) over log(size)
+double GrowthExponent(const std::vector<size_t>& sizes, const std::vector<uint64_t>& ns) {
+	size_t num = sizes.size();
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (size_t i = 0;i < num;++i) {
+		double x = log(static_cast<double>(sizes[i]));
+		double y = log(static_cast<double>(ns[i] > 0 ? ns[i] : 1));
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	double d = num * sxx - sx * sx;
+	return d == 0 ? 0 : (num * sxy - sx * sy) / d;
+}
+
+
+int main(int argc, char** argv) {
+	const char* font_dir = argc > 1 ? argv[1] : BENCH_FONT_DIR;
+	size_t max_size = argc > 2 ? strtoul(argv[2], nullptr, 10) : 8192;
+	if (max_size < CLIFF_MIN_SIZE * 2)
+		max_size = CLIFF_MIN_SIZE * 2;
+
+	BenchEnv env;
+	if (!env.Init(font_dir))
+		return 1;
+	FontCollection* ff = env.GetFontCollection();
+
+	const CliffCase cases[] = {
+		{ "nobreak", GenerateNoBreak, "x" },
+		{ "scripts", GenerateScripts, u8"ب" },
+		{ "nested_bidi", GenerateNestedBidi, "a" },
+		{ "paragraphs", GenerateParagraphs, "x" },
+	};
+	std::vector<size_t> sizes;
+	for (size_t n = CLIFF_MIN_SIZE;n <= max_size;n *= 2)
+		sizes.push_back(n);
+
+	printf("%-12s %-24s", "input", "operation");
+	for (size_t i = 0;i < sizes.size();++i)
+		printf(" %9zu", sizes[i]);
+	printf(" %8s\n", "exponent");
+
+	size_t flagged = 0;
+	for (size_t c = 0;c < sizeof(cases) / sizeof(cases[0]);++c) {
+		std::vector<uint64_t> ns[CLIFF_OP_NUM];
+		for (size_t i = 0;i < sizes.size();++i) {
+			uint64_t op_ns[CLIFF_OP_NUM];
+			MeasureCase(ff, cases[c], sizes[i], op_ns);
+			for (int op = 0;op < CLIFF_OP_NUM;++op)
+				ns[op].push_back(op_ns[op]);
+		}
+		for (int op = 0;op < CLIFF_OP_NUM;++op) {
+			double exponent = GrowthExponent(sizes, ns[op]);
+			bool cliff = exponent > CLIFF_EXPONENT;
+			printf("%-12s %-24s", cases[c].name, cliff_op_names[op]);
+			//Milliseconds, the growth between columns is what matters
+			for (size_t i = 0;i < sizes.size();++i)
+				printf(" %9.3f", ns[op][i] / 1e6);
+			printf(" %8.2f%s\n", exponent, cliff ? "  CLIFF" : "");
+			flagged += cliff ? 1 : 0;
+		}
+	}
+	if (flagged > 0) {
+		printf("%zu operations grow faster than linearly (exponent > %.1f)\n", flagged, CLIFF_EXPONENT);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,333 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Container microbenchmark. Compares Array, List and Map with std::vector,
+//std::list and std::unordered_map on the element types the engine stores.
+//Usage: TextEngineContainerBench [scale]
+
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "BenchUtils.h"
+#include "Array.h"
+#include "List.h"
+#include "Map.h"
+#include "TextEngine.h"
+
+//Middle-of-container edits are O(n) in both, keep their count bounded
+#define MAX_MIDDLE_EDITS 512
+#define RANGE_EDIT_LEN 64
+
+volatile uint64_t bench_sink = 0;
+
+
+void PrintContainerHeader() {
+	printf(
+		"%-6s %-22s %8s %-12s %12s %12s %8s\n",
+		"kind", "element", "size", "operation", "ours ns/op", "std ns/op", "ratio"
+	);
+}
+
+
+void PrintContainerRow(const char* kind, const char* element, size_t n, const char* op, uint64_t ours_ns, uint64_t std_ns, size_t ops) {
+	double ours = ops == 0 ? 0 : static_cast<double>(ours_ns) / ops;
+	double other = ops == 0 ? 0 : static_cast<double>(std_ns) / ops;
+	printf(
+		"%-6s %-22s %8zu %-12s %12.2f %12.2f %7.2fx\n",
+		kind, element, n, op, ours, other, other == 0 ? 0 : ours / other
+	);
+}
+
+
+template<typename T, typename Touch>
+void BenchArray(const char* element, size_t n, Touch touch) {
+	std::vector<size_t> index(n);
+	BenchRandom rand;
+	for (size_t i = 0;i < n;++i)
+		index[i] = rand.Below(n);
+	size_t edits = n < MAX_MIDDLE_EDITS ? n : MAX_MIDDLE_EDITS;
+	T value = T();
+	uint64_t t0, t1, t2, t3;
+
+	Array<T> a;
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		a.Push(value);
+	t1 = BenchNowNs();
+	std::vector<T> v;
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		v.push_back(value);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Push", t1 - t0, t3 - t2, n);
+
+	uint64_t sum = 0;
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += touch(a.Get(i));
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += touch(v[i]);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Get seq", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (const T& e : a)
+		sum += touch(e);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (const T& e : v)
+		sum += touch(e);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Iterate", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	a.ForEachSpan([&](T* span, size_t num) {
+		for (size_t i = 0;i < num;++i)
+			sum += touch(span[i]);
+	});
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += touch(v[i]);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "ForEachSpan", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += touch(a.Get(index[i]));
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += touch(v[index[i]]);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Get random", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		a.Set(index[i], value);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		v[index[i]] = value;
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Set", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		a.Insert(index[i] % a.GetSize(), value);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		v.insert(v.begin() + index[i] % v.size(), value);
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Insert", t1 - t0, t3 - t2, edits);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		a.Remove(index[i] % a.GetSize());
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		v.erase(v.begin() + index[i] % v.size());
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "Remove", t1 - t0, t3 - t2, edits);
+
+	//A pasted run of RANGE_EDIT_LEN elements, then its removal
+	std::vector<T> run(RANGE_EDIT_LEN, value);
+	Array<T> src;
+	src.AppendRange(run.data(), run.size());
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		a.InsertRange(index[i] % a.GetSize(), src, 0, RANGE_EDIT_LEN);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		v.insert(v.begin() + index[i] % v.size(), run.begin(), run.end());
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "InsertRange", t1 - t0, t3 - t2, edits);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i)
+		a.RemoveRange(index[i] % (a.GetSize() - RANGE_EDIT_LEN), RANGE_EDIT_LEN);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < edits;++i) {
+		size_t at = index[i] % (v.size() - RANGE_EDIT_LEN);
+		v.erase(v.begin() + at, v.begin() + at + RANGE_EDIT_LEN);
+	}
+	t3 = BenchNowNs();
+	PrintContainerRow("array", element, n, "RemoveRange", t1 - t0, t3 - t2, edits);
+	if (a.GetSize() != v.size())
+		printf("array size mismatch after RemoveRange: %zu vs %zu\n", a.GetSize(), v.size());
+	bench_sink += sum;
+}
+
+
+template<typename T, typename Touch>
+void BenchList(const char* element, size_t n, Touch touch) {
+	T value = T();
+	uint64_t t0, t1, t2, t3;
+	uint64_t sum = 0;
+	List<T> l;
+	std::list<T> s;
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		l.PushBack(value);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		s.push_back(value);
+	t3 = BenchNowNs();
+	PrintContainerRow("list", element, n, "PushBack", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (auto p = l.GetFront();!p.IsNull();p.Next())
+		sum += touch(p.Data());
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (auto p = s.begin();p != s.end();++p)
+		sum += touch(*p);
+	t3 = BenchNowNs();
+	PrintContainerRow("list", element, n, "Iterate", t1 - t0, t3 - t2, n);
+
+	//Splice in after every node, the way segments are split
+	t0 = BenchNowNs();
+	for (auto p = l.GetFront();!p.IsNull();p.Next()) {
+		l.InsertAfter(p, value);
+		p.Next();
+	}
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (auto p = s.begin();p != s.end();++p)
+		p = s.insert(std::next(p), value);
+	t3 = BenchNowNs();
+	PrintContainerRow("list", element, n, "InsertAfter", t1 - t0, t3 - t2, n);
+
+	size_t num = l.GetSize();
+	t0 = BenchNowNs();
+	while (!l.IsEmpty())
+		l.PopFront();
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	while (!s.empty())
+		s.pop_front();
+	t3 = BenchNowNs();
+	PrintContainerRow("list", element, n, "PopFront", t1 - t0, t3 - t2, num);
+	bench_sink += sum;
+}
+
+
+void BenchMap(size_t n) {
+	const char* element = "FT_UInt -> GlyphInfo";
+	std::vector<FT_UInt> keys(n);
+	std::vector<FT_UInt> missing(n);
+	//Glyph indices of a font are dense, the cache holds a random subset
+	BenchRandom rand;
+	for (size_t i = 0;i < n;++i) {
+		keys[i] = static_cast<FT_UInt>(1 + rand.Below(n * 4));
+		missing[i] = static_cast<FT_UInt>(n * 4 + 1 + rand.Below(n * 4));
+	}
+	GlyphInfo gi = GlyphInfo();
+	uint64_t t0, t1, t2, t3;
+	uint64_t sum = 0;
+	Map<FT_UInt, GlyphInfo> m;
+	std::unordered_map<FT_UInt, GlyphInfo> u;
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		m.Set(keys[i], gi);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		u[keys[i]] = gi;
+	t3 = BenchNowNs();
+	PrintContainerRow("map", element, n, "Set new", t1 - t0, t3 - t2, n);
+	if (m.GetSize() != u.size())
+		printf("map size mismatch after Set: %zu vs %zu\n", m.GetSize(), u.size());
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		m.Set(keys[i], gi);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		u[keys[i]] = gi;
+	t3 = BenchNowNs();
+	PrintContainerRow("map", element, n, "Set exist", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i) {
+		auto ref = m.Find(keys[i]);
+		if (!ref.IsNull())
+			sum += ref.Value().region_index;
+	}
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i) {
+		auto it = u.find(keys[i]);
+		if (it != u.end())
+			sum += it->second.region_index;
+	}
+	t3 = BenchNowNs();
+	PrintContainerRow("map", element, n, "Find hit", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += m.Find(missing[i]).IsNull() ? 0 : 1;
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		sum += u.find(missing[i]) == u.end() ? 0 : 1;
+	t3 = BenchNowNs();
+	PrintContainerRow("map", element, n, "Find miss", t1 - t0, t3 - t2, n);
+
+	t0 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		m.Remove(keys[i]);
+	t1 = BenchNowNs();
+	t2 = BenchNowNs();
+	for (size_t i = 0;i < n;++i)
+		u.erase(keys[i]);
+	t3 = BenchNowNs();
+	PrintContainerRow("map", element, n, "Remove", t1 - t0, t3 - t2, n);
+	if (m.GetSize() != u.size())
+		printf("map size mismatch after Remove: %zu vs %zu\n", m.GetSize(), u.size());
+	bench_sink += sum;
+}
+
+
+uint64_t TouchParagraphExtent(const ParagraphExtent& extent) {
+	return extent.bytes + extent.cps;
+}
+
+
+uint64_t TouchMappedGlyph(const MappedGlyph& mg) {
+	return mg.map + mg.gi.region_index;
+}
+
+
+int main(int argc, char** argv) {
+	size_t scale = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1;
+	if (scale == 0)
+		scale = 1;
+
+	PrintContainerHeader();
+	//The paragraph index of a document, then of a long log
+	BenchArray<ParagraphExtent>("ParagraphExtent", 2048 * scale, TouchParagraphExtent);
+	BenchArray<ParagraphExtent>("ParagraphExtent", 65536 * scale, TouchParagraphExtent);
+	//The glyphs of a line, then of a long unbroken line
+	BenchArray<MappedGlyph>("MappedGlyph", 96 * scale, TouchMappedGlyph);
+	BenchArray<MappedGlyph>("MappedGlyph", 4096 * scale, TouchMappedGlyph);
+	BenchList<MappedGlyph>("MappedGlyph", 64 * scale, TouchMappedGlyph);
+	BenchList<MappedGlyph>("MappedGlyph", 4096 * scale, TouchMappedGlyph);
+	//A script's worth of glyphs, a full font, a CJK font
+	BenchMap(256 * scale);
+	BenchMap(2048 * scale);
+	BenchMap(16384 * scale);
+	return 0;
+}
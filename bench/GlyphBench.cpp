@@ -0,0 +1,184 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Glyph cache and atlas benchmark. Rasterizes every glyph of the bench fonts
+//through FontCollection::GetGlyph, then packs synthetic CJK and emoji sized
+//sets straight into Atlas pages and RectanglePacker faces.
+//Usage: TextEngineGlyphBench [font_dir] [synthetic_glyphs]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "BenchUtils.h"
+#include "CubeAtlas.h"
+#include "FontCollection.h"
+
+#define ATLAS_FACE_NUM 6
+//FreeType's SDF renderer is two orders of magnitude slower, sample each font
+#define SDF_GLYPHS_PER_FONT 256
+
+const uint32_t glyph_pixel_heights[] = { 16, 32, 64 };
+#define GLYPH_PIXEL_HEIGHT_NUM (sizeof(glyph_pixel_heights) / sizeof(glyph_pixel_heights[0]))
+
+
+double AtlasOccupancy(uint64_t used_surface, size_t pages, uint32_t atlas_size) {
+	uint64_t total = static_cast<uint64_t>(pages) * ATLAS_FACE_NUM * atlas_size * atlas_size;
+	return total == 0 ? 0 : used_surface * 100.0 / total;
+}
+
+
+void BenchGetGlyph(const char* font_dir, uint32_t pixel_height, bool use_sdf) {
+	BenchEnv env;
+	if (!env.Init(font_dir, pixel_height, use_sdf))
+		return;
+	FontCollection* ff = env.GetFontCollection();
+	size_t atlas_bytes_before = ff->GetMemoryStats().categories[MEMORY_CATEGORY_ATLAS].reserved;
+
+	size_t glyphs = 0;
+	uint64_t miss_ns = 0;
+	uint64_t hit_ns = 0;
+	GlyphInfo gi;
+	for (Font* font = ff->GetFirstFont();font != nullptr;font = font->Next()) {
+		FT_UInt num = static_cast<FT_UInt>(font->GetFTFont()->num_glyphs);
+		if (use_sdf && num > SDF_GLYPHS_PER_FONT)
+			num = SDF_GLYPHS_PER_FONT;
+		uint64_t t0 = BenchNowNs();
+		for (FT_UInt i = 1;i < num;++i)
+			glyphs += ff->GetGlyph(i, font, gi) ? 1 : 0;
+		uint64_t t1 = BenchNowNs();
+		//Glyphs too large for a face are not cached and rasterize again here
+		for (FT_UInt i = 1;i < num;++i)
+			ff->GetGlyph(i, font, gi);
+		uint64_t t2 = BenchNowNs();
+		miss_ns += t1 - t0;
+		hit_ns += t2 - t1;
+	}
+
+	size_t pages = ff->GetAtlasNum(false);
+	uint64_t used_surface = 0;
+	for (size_t i = 0;i < pages;++i)
+		used_surface += ff->GetAtlas(false, i)->getUsedSurface();
+	MemoryStats stats = ff->GetMemoryStats();
+	size_t atlas_bytes = stats.categories[MEMORY_CATEGORY_ATLAS].reserved - atlas_bytes_before;
+	printf(
+		"%-6s %4upx %8zu %12.0f %12.0f %6zu %12.1f %12.1f %10.1f%%\n",
+		use_sdf ? "sdf" : "gray", pixel_height, glyphs,
+		miss_ns == 0 ? 0 : glyphs * 1e9 / miss_ns,
+		hit_ns == 0 ? 0 : glyphs * 1e9 / hit_ns,
+		pages,
+		glyphs == 0 ? 0 : static_cast<double>(atlas_bytes) / glyphs,
+		glyphs == 0 ? 0 : static_cast<double>(stats.categories[MEMORY_CATEGORY_GLYPH_CACHE].reserved) / glyphs,
+		AtlasOccupancy(used_surface, pages, ATLAS_SIZE_GRAY)
+	);
+}
+
+
+//Chains Atlas pages the way FontCollection does and prints the occupancy at
+//a few checkpoints while the set grows
+void BenchAtlasFill(uint32_t pixel_height, bool is_bgra, size_t glyph_num) {
+	uint16_t atlas_size = is_bgra ? ATLAS_SIZE_RGBA : ATLAS_SIZE_GRAY;
+	size_t bpp = is_bgra ? 4 : 1;
+	std::vector<uint8_t> bitmap(pixel_height * pixel_height * bpp, 0x80);
+	std::vector<Atlas*> pages;
+	BenchRandom rand;
+
+	size_t checkpoint = glyph_num / 8;
+	uint64_t ns = 0;
+	uint64_t used_surface = 0;
+	size_t added = 0;
+	for (size_t i = 0;i < glyph_num;++i) {
+		//CJK ideographs and emoji fill most of the em box
+		uint16_t w = static_cast<uint16_t>(pixel_height * 3 / 4 + rand.Below(pixel_height / 4 + 1));
+		uint16_t h = static_cast<uint16_t>(pixel_height * 3 / 4 + rand.Below(pixel_height / 4 + 1));
+		uint64_t t0 = BenchNowNs();
+		uint16_t region = UINT16_MAX;
+		for (size_t p = 0;p < pages.size() && region >= MAX_REGION_NUM;++p)
+			region = pages[p]->addRegion(w, h, bitmap.data(), 1);
+		if (region >= MAX_REGION_NUM) {
+			pages.push_back(new Atlas(atlas_size, MAX_REGION_NUM, is_bgra));
+			region = pages.back()->addRegion(w, h, bitmap.data(), 1);
+		}
+		ns += BenchNowNs() - t0;
+		if (region >= MAX_REGION_NUM)
+			break;
+		++added;
+		used_surface += (w + 2) * (h + 2);
+		if (checkpoint != 0 && (added % checkpoint == 0 || added == glyph_num)) {
+			size_t bytes = pages.size() * (pages.back()->getTextureBufferSize() + MAX_REGION_NUM * sizeof(AtlasRegion));
+			printf(
+				"%-6s %4upx %8zu %12.0f %6zu %12.1f %10.1f%%\n",
+				is_bgra ? "bgra" : "gray", pixel_height, added,
+				ns == 0 ? 0 : added * 1e9 / ns,
+				pages.size(),
+				static_cast<double>(bytes) / added,
+				AtlasOccupancy(used_surface, pages.size(), atlas_size)
+			);
+		}
+	}
+	for (size_t i = 0;i < pages.size();++i)
+		delete pages[i];
+}
+
+
+void BenchPacker(uint32_t pixel_height) {
+	RectanglePacker packer(ATLAS_SIZE_GRAY, ATLAS_SIZE_GRAY);
+	BenchRandom rand;
+	size_t added = 0;
+	size_t faces = 0;
+	uint64_t ns = 0;
+	double usage = 0;
+	//Fill a handful of faces from empty to full
+	while (faces < 16) {
+		uint16_t w = static_cast<uint16_t>(pixel_height / 4 + rand.Below(pixel_height * 3 / 4 + 1));
+		uint16_t h = static_cast<uint16_t>(pixel_height / 2 + rand.Below(pixel_height / 2 + 1));
+		uint16_t x, y;
+		uint64_t t0 = BenchNowNs();
+		bool ok = packer.addRectangle(w + 2, h + 2, x, y);
+		ns += BenchNowNs() - t0;
+		if (ok) {
+			++added;
+			continue;
+		}
+		usage += packer.getUsageRatio();
+		packer.clear();
+		++faces;
+	}
+	printf(
+		"%4upx %10zu %12.0f %10.1f%%\n",
+		pixel_height, added,
+		ns == 0 ? 0 : added * 1e9 / ns,
+		usage * 100 / faces
+	);
+}
+
+
+int main(int argc, char** argv) {
+	const char* font_dir = argc > 1 ? argv[1] : BENCH_FONT_DIR;
+	size_t synthetic = argc > 2 ? strtoul(argv[2], nullptr, 10) : 8192;
+
+	printf("FontCollection::GetGlyph, every glyph of the bench fonts\n");
+	printf(
+		"%-6s %6s %8s %12s %12s %6s %12s %12s %11s\n",
+		"mode", "height", "glyphs", "miss/sec", "hit/sec", "pages", "atlas B/gl", "cache B/gl", "occupancy"
+	);
+	for (int sdf = 0;sdf < 2;++sdf)
+		for (size_t i = 0;i < GLYPH_PIXEL_HEIGHT_NUM;++i)
+			BenchGetGlyph(font_dir, glyph_pixel_heights[i], sdf != 0);
+
+	printf("\nAtlas::addRegion, synthetic CJK (gray) and emoji (bgra) sized sets\n");
+	printf(
+		"%-6s %6s %8s %12s %6s %12s %11s\n",
+		"mode", "height", "glyphs", "glyphs/sec", "pages", "atlas B/gl", "occupancy"
+	);
+	for (size_t i = 0;i < GLYPH_PIXEL_HEIGHT_NUM;++i)
+		BenchAtlasFill(glyph_pixel_heights[i], false, synthetic);
+	//Color fonts carry far fewer glyphs than CJK ones
+	for (size_t i = 0;i < GLYPH_PIXEL_HEIGHT_NUM;++i)
+		BenchAtlasFill(glyph_pixel_heights[i], true, synthetic / 2);
+
+	printf("\nRectanglePacker::addRectangle, %dx%d faces filled to capacity\n", ATLAS_SIZE_GRAY, ATLAS_SIZE_GRAY);
+	printf("%6s %10s %12s %11s\n", "height", "rects", "rects/sec", "usage");
+	for (size_t i = 0;i < GLYPH_PIXEL_HEIGHT_NUM;++i)
+		BenchPacker(glyph_pixel_heights[i]);
+	return 0;
+}
@@ -0,0 +1,312 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Headless layout benchmark. Measures TextEngine::Append/Insert/Delete/GetText,
+//TextAppender, byte offset conversions and Paragraph::SloveLayout over a
+//multilingual corpus, no display needed.
+//Usage: TextEngineBench [font_dir] [edits] [trace.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "BenchUtils.h"
+#include "TextEngine.h"
+
+#define APPEND_REPEAT 5
+#define LAYOUT_REPEAT 5
+//Bytes per read of the streamed corpus, cutting codepoints at random
+#define STREAM_CHUNK 509
+
+
+void BenchAppend(FontCollection* ff, const BenchCorpus& corpus, LatencySamples& samples) {
+	size_t cp_num = CountUtf8Codepoints(corpus.text.c_str(), corpus.text.size());
+	for (int r = 0;r < APPEND_REPEAT;++r) {
+		TextEngine te(ff, BENCH_WARP_WIDTH);
+		uint64_t t0 = BenchNowNs();
+		te.Append(corpus.text.c_str(), corpus.text.size());
+		uint64_t t1 = BenchNowNs();
+		samples.Add(t1 - t0, cp_num);
+		te.Clear();
+	}
+}
+
+
+//The corpus fed in STREAM_CHUNK byte reads, through Append or a TextAppender
+void BenchStream(FontCollection* ff, const BenchCorpus& corpus, bool appender, LatencySamples& samples) {
+	size_t cp_num = CountUtf8Codepoints(corpus.text.c_str(), corpus.text.size());
+	const char* text = corpus.text.c_str();
+	size_t len = corpus.text.size();
+	for (int r = 0;r < APPEND_REPEAT;++r) {
+		TextEngine te(ff, BENCH_WARP_WIDTH);
+		uint64_t t0 = BenchNowNs();
+		if (appender) {
+			TextAppender stream(&te);
+			for (size_t i = 0;i < len;i += STREAM_CHUNK)
+				stream.Write(text + i, len - i < STREAM_CHUNK ? len - i : STREAM_CHUNK);
+		}
+		else {
+			for (size_t i = 0;i < len;i += STREAM_CHUNK)
+				te.Append(text + i, len - i < STREAM_CHUNK ? len - i : STREAM_CHUNK);
+		}
+		uint64_t t1 = BenchNowNs();
+		samples.Add(t1 - t0, cp_num);
+		te.Clear();
+	}
+}
+
+
+//An edit elsewhere between a write and its flush, the written codepoints are
+//still laid out
+bool CheckAppenderAfterEdit(FontCollection* ff) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append("hello\n", 6);
+	TextAppender stream(&te);
+	stream.Write("world", 5);
+	te.Insert("x", 1, CPPos(0, 0));
+	stream.Flush();
+	Paragraph* last = te.GetParagraph(te.GetParagarphNum() - 1);
+	return last->cps.GetSize() == 5 && last->lines.GetSize() > 0;
+}
+
+
+//Lone CRs, CRLFs and newlines export as they came, every byte offset maps to
+//a position and back
+bool CheckLineEndOffsets(FontCollection* ff) {
+	const char* text = "a\rb\r\nc\nd\r\r\n\re";
+	size_t len = strlen(text);
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(text, len);
+	std::string out(te.GetText(nullptr, 0), '\0');
+	te.GetText(&out[0], out.size());
+	if (out != text)
+		return false;
+	for (size_t offset = 0;offset <= len;++offset)
+		if (te.PosToByteOffset(te.ByteOffsetToPos(offset)) != offset)
+			return false;
+	return true;
+}
+
+
+//Whole document export into a buffer sized by a measuring call
+void BenchGetText(FontCollection* ff, const BenchCorpus& corpus, LatencySamples& samples) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	size_t cp_num = CountUtf8Codepoints(corpus.text.c_str(), corpus.text.size());
+	std::string text;
+	for (int r = 0;r < APPEND_REPEAT;++r) {
+		uint64_t t0 = BenchNowNs();
+		text.resize(te.GetText(nullptr, 0));
+		te.GetText(&text[0], text.size());
+		uint64_t t1 = BenchNowNs();
+		samples.Add(t1 - t0, cp_num);
+	}
+	te.Clear();
+}
+
+
+//A random byte offset to CPPos and back, as a language server asks
+void BenchOffsets(FontCollection* ff, const BenchCorpus& corpus, size_t edits, LatencySamples& samples) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	size_t len = te.GetText(nullptr, 0);
+	BenchRandom rand;
+	for (size_t i = 0;i < edits;++i) {
+		size_t offset = rand.Below(len + 1);
+		uint64_t t0 = BenchNowNs();
+		CPPos pos = te.ByteOffsetToPos(offset);
+		size_t back = te.PosToByteOffset(pos);
+		uint64_t t1 = BenchNowNs();
+		//Counts conversions in the cps column
+		samples.Add(t1 - t0, back <= len ? 1 : 0);
+	}
+	te.Clear();
+}
+
+
+void BenchInsert(FontCollection* ff, const BenchCorpus& corpus, size_t edits, LatencySamples& samples, PipelineStats& stats) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	te.ResetPipelineStats();
+	BenchRandom rand;
+	size_t len = strlen(corpus.insert_text);
+	for (size_t i = 0;i < edits;++i) {
+		size_t p = rand.Below(te.GetParagarphNum());
+		size_t cp = rand.Below(te.GetParagraph(p)->cps.GetSize() + 1);
+		uint64_t t0 = BenchNowNs();
+		te.Insert(corpus.insert_text, len, CPPos(p, cp));
+		uint64_t t1 = BenchNowNs();
+		samples.Add(t1 - t0, te.GetParagraph(p)->cps.GetSize());
+	}
+	stats = te.GetPipelineStats();
+	te.Clear();
+}
+
+
+void BenchDelete(FontCollection* ff, const BenchCorpus& corpus, size_t edits, LatencySamples& samples) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	BenchRandom rand;
+	for (size_t i = 0;i < edits;++i) {
+		size_t p = rand.Below(te.GetParagarphNum());
+		size_t cp_num = te.GetParagraph(p)->cps.GetSize();
+		if (cp_num == 0)
+			continue;
+		size_t cp = rand.Below(cp_num);
+		uint64_t t0 = BenchNowNs();
+		te.Delete(CPPos(p, cp), CPPos(p, cp + 1));
+		uint64_t t1 = BenchNowNs();
+		samples.Add(t1 - t0, te.GetParagraph(p)->cps.GetSize());
+	}
+	te.Clear();
+}
+
+
+void BenchLayout(FontCollection* ff, const BenchCorpus& corpus, LatencySamples& samples) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	for (int r = 0;r < LAYOUT_REPEAT;++r) {
+		for (size_t p = 0;p < te.GetParagarphNum();++p) {
+			Paragraph* paragraph = te.GetParagraph(p);
+			uint64_t t0 = BenchNowNs();
+			paragraph->SloveLayout();
+			uint64_t t1 = BenchNowNs();
+			samples.Add(t1 - t0, paragraph->cps.GetSize());
+		}
+	}
+	te.Clear();
+}
+
+
+void BenchMemory(FontCollection* ff, const BenchCorpus& corpus) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	PrintMemoryStats(corpus.name, te.GetMemoryStats());
+}
+
+
+//An empty engine and a one word label, the cost of a small text widget
+void BenchWidgetMemory(FontCollection* ff) {
+	TextEngine empty(ff, BENCH_WARP_WIDTH);
+	PrintMemoryStats("empty", empty.GetMemoryStats());
+	TextEngine label(ff, BENCH_WARP_WIDTH);
+	label.Append("OK", 2);
+	PrintMemoryStats("label", label.GetMemoryStats());
+}
+
+
+//A short editing and resizing session recorded as a Chrome trace
+void BenchTrace(FontCollection* ff, const BenchCorpus& corpus, TraceRecorder* recorder) {
+	TextEngine te(ff, BENCH_WARP_WIDTH);
+	te.SetTraceRecorder(recorder);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	BenchRandom rand;
+	size_t len = strlen(corpus.insert_text);
+	for (size_t i = 0;i < 10;++i) {
+		size_t p = rand.Below(te.GetParagarphNum());
+		size_t cp = rand.Below(te.GetParagraph(p)->cps.GetSize() + 1);
+		te.Insert(corpus.insert_text, len, CPPos(p, cp));
+		te.Delete(CPPos(p, cp), CPPos(p, cp + 1));
+	}
+	te.SetWarpWidth(BENCH_WARP_WIDTH / 2);
+	te.SetWarpWidth(BENCH_WARP_WIDTH * 3 / 4);
+	te.SetWarpWidth(BENCH_WARP_WIDTH);
+	te.Clear();
+}
+
+
+//Average time per Insert spent in each stage, only available with TEXT_ENGINE_STATS
+#ifdef TEXT_ENGINE_STATS
+void PrintStageBreakdown(const char* corpus, const PipelineStats& stats) {
+	if (stats.edits == 0)
+		return;
+	printf("%-10s insert stages (us/edit):", corpus);
+	for (int i = 0;i < PIPELINE_STAGE_NUM;++i)
+		printf(" %s=%.2f", PipelineStageName(i), stats.stages[i].total_ns / 1000.0 / stats.edits);
+	printf(
+		" | cache hit/miss=%llu/%llu atlas_insertions=%llu shaped_cps=%llu\n",
+		(unsigned long long)stats.glyph_cache_hits,
+		(unsigned long long)stats.glyph_cache_misses,
+		(unsigned long long)stats.atlas_insertions,
+		(unsigned long long)stats.shaped_codepoints
+	);
+}
+#else
+void PrintStageBreakdown(const char*, const PipelineStats&) {}
+#endif
+
+
+int main(int argc, char** argv) {
+	const char* font_dir = argc > 1 ? argv[1] : BENCH_FONT_DIR;
+	size_t edits = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+	const char* trace_path = argc > 3 ? argv[3] : nullptr;
+
+	BenchEnv env;
+	if (!env.Init(font_dir))
+		return 1;
+	FontCollection* ff = env.GetFontCollection();
+	if (!CheckAppenderAfterEdit(ff)) {
+		printf("TextAppender::Flush left codepoints written before an edit unlaid out\n");
+		return 1;
+	}
+	if (!CheckLineEndOffsets(ff)) {
+		printf("byte offsets of CR and CRLF line ends do not round trip\n");
+		return 1;
+	}
+
+	std::vector<BenchCorpus> corpus;
+	BuildBenchCorpus(corpus);
+
+	std::vector<PipelineStats> insert_stats(corpus.size());
+	PrintLatencyHeader();
+	for (size_t i = 0;i < corpus.size();++i) {
+		LatencySamples samples;
+		BenchAppend(ff, corpus[i], samples);
+		PrintLatencyRow(corpus[i].name, "TextEngine::Append", samples);
+		samples.Clear();
+		BenchStream(ff, corpus[i], false, samples);
+		PrintLatencyRow(corpus[i].name, "Append chunks", samples);
+		samples.Clear();
+		BenchStream(ff, corpus[i], true, samples);
+		PrintLatencyRow(corpus[i].name, "TextAppender::Write", samples);
+		samples.Clear();
+		BenchInsert(ff, corpus[i], edits, samples, insert_stats[i]);
+		PrintLatencyRow(corpus[i].name, "TextEngine::Insert", samples);
+		samples.Clear();
+		BenchDelete(ff, corpus[i], edits, samples);
+		PrintLatencyRow(corpus[i].name, "TextEngine::Delete", samples);
+		samples.Clear();
+		BenchLayout(ff, corpus[i], samples);
+		PrintLatencyRow(corpus[i].name, "Paragraph::SloveLayout", samples);
+		samples.Clear();
+		BenchGetText(ff, corpus[i], samples);
+		PrintLatencyRow(corpus[i].name, "TextEngine::GetText", samples);
+		samples.Clear();
+		BenchOffsets(ff, corpus[i], edits, samples);
+		PrintLatencyRow(corpus[i].name, "ByteOffsetToPos+back", samples);
+	}
+	for (size_t i = 0;i < corpus.size();++i)
+		PrintStageBreakdown(corpus[i].name, insert_stats[i]);
+
+	printf("\n");
+	for (size_t i = 0;i < corpus.size();++i)
+		BenchMemory(ff, corpus[i]);
+	BenchWidgetMemory(ff);
+	PrintMemoryStats("fonts", ff->GetMemoryStats());
+	MemoryStats global_stats;
+	global_memory_account.Fill(global_stats);
+	PrintMemoryStats("global", global_stats);
+
+	if (trace_path != nullptr) {
+		TraceRecorder recorder;
+		for (size_t i = 0;i < corpus.size();++i)
+			BenchTrace(ff, corpus[i], &recorder);
+		if (recorder.WriteJson(trace_path))
+			printf("wrote %zu trace events to %s\n", recorder.GetEventNum(), trace_path);
+		else
+			printf("failed to write trace to %s\n", trace_path);
+	}
+
+	env.Release();
+	return 0;
+}
@@ -0,0 +1,116 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//Offscreen rendering benchmark. Composites laid out documents into an RGBA
+//buffer with the demo's software renderer, no display needed.
+//Usage: TextEngineRenderBench [font_dir] [frames]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "BenchUtils.h"
+#include "SoftRenderer.h"
+#include "TextEngine.h"
+
+#define RENDER_LINE_GAP 8
+#define RENDER_LINE_HEIGHT (BENCH_FONT_SIZE + RENDER_LINE_GAP)
+
+struct RenderViewport {
+	int w;
+	int h;
+};
+
+const RenderViewport render_viewports[] = {
+	{ 320, 240 },
+	{ 640, 480 },
+	{ 1280, 720 },
+	{ 1920, 1080 },
+};
+
+const char* render_scroll_names[] = { "top", "middle", "bottom" };
+
+
+float ComputeDocumentHeight(TextEngine* te) {
+	float height = 0;
+	for (size_t i = 0;i < te->GetParagarphNum();++i) {
+		size_t line_num = te->GetParagraph(i)->lines.GetSize();
+		height += (line_num == 0 ? 1 : line_num) * RENDER_LINE_HEIGHT;
+	}
+	return height;
+}
+
+
+void BenchRender(FontCollection* ff, const BenchCorpus& corpus, size_t frames) {
+	TextEngine te(ff, render_viewports[0].w);
+	te.Append(corpus.text.c_str(), corpus.text.size());
+	size_t last = te.GetParagarphNum() - 1;
+	CPPos doc_begin(0, 0);
+	CPPos doc_end(last, te.GetParagraph(last)->cps.GetSize());
+	std::vector<uint8_t> buffer;
+
+	for (size_t v = 0;v < sizeof(render_viewports) / sizeof(render_viewports[0]);++v) {
+		int w = render_viewports[v].w;
+		int h = render_viewports[v].h;
+		te.SetWarpWidth(w);
+		buffer.assign(static_cast<size_t>(w) * h * 4, 0);
+		float scroll_max = ComputeDocumentHeight(&te) - h;
+		if (scroll_max < 0)
+			scroll_max = 0;
+		for (int s = 0;s < 3;++s) {
+			float offset = scroll_max * s / 2;
+			//Without and with the whole document selected
+			for (int selected = 0;selected < 2;++selected) {
+				const CPPos& spos = selected ? doc_begin : doc_end;
+				size_t glyphs = DrawText(
+					buffer.data(), w, h, ff, &te, doc_end, spos,
+					offset, BENCH_FONT_SIZE, RENDER_LINE_HEIGHT, true
+				);
+				uint64_t t0 = BenchNowNs();
+				for (size_t f = 0;f < frames;++f) {
+					memset(buffer.data(), 0, buffer.size());
+					DrawText(
+						buffer.data(), w, h, ff, &te, doc_end, spos,
+						offset, BENCH_FONT_SIZE, RENDER_LINE_HEIGHT, true
+					);
+				}
+				uint64_t ns = BenchNowNs() - t0;
+				printf(
+					"%-10s %5dx%-5d %-7s %-9s %8zu %10.1f %12.1f %10zu\n",
+					corpus.name, w, h,
+					render_scroll_names[s], selected ? "selected" : "none",
+					frames,
+					ns == 0 ? 0 : frames * 1e9 / ns,
+					glyphs == 0 ? 0 : static_cast<double>(ns) / (frames * glyphs),
+					glyphs
+				);
+			}
+		}
+	}
+	te.Clear();
+}
+
+
+int main(int argc, char** argv) {
+	const char* font_dir = argc > 1 ? argv[1] : BENCH_FONT_DIR;
+	size_t frames = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+	if (frames == 0)
+		frames = 1;
+
+	BenchEnv env;
+	if (!env.Init(font_dir))
+		return 1;
+
+	std::vector<BenchCorpus> corpus;
+	BuildBenchCorpus(corpus);
+
+	printf(
+		"%-10s %-11s %-7s %-9s %8s %10s %12s %10s\n",
+		"corpus", "viewport", "scroll", "highlight", "frames", "fps", "ns/glyph", "glyphs"
+	);
+	for (size_t i = 0;i < corpus.size();++i)
+		BenchRender(env.GetFontCollection(), corpus[i], frames);
+
+	env.Release();
+	return 0;
+}
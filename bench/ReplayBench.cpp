@@ -0,0 +1,153 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "BenchUtils.h"
+#include "EditSession.h"
+#include "EditTrace.h"
+
+#define REPLAY_FONT_SIZE 64
+#define REPLAY_LINE_GAP 8
+#define REPLAY_WIN_W 640
+#define REPLAY_WIN_H 480
+
+
+//Scripted session standing in for a recording made with TextEngineDemo --record,
+//touches every event type so the replayer can run without a display
+bool GenerateTrace(FontCollection* ff, const char* path) {
+	const char* str = u8"The title is مفتاح معايير الويب in Arabic.";
+	const char* words[] = { "lorem ", "ipsum ", u8"مرحبا ", "dolor ", u8"بالعالم ", "sit ", "amet, " };
+	float lh = REPLAY_FONT_SIZE + REPLAY_LINE_GAP;
+
+	EditTraceWriter writer;
+	if (!writer.Open(path, REPLAY_FONT_SIZE, lh, REPLAY_WIN_W, REPLAY_WIN_H, str, strlen(str)))
+		return false;
+	TextEngine te(ff, REPLAY_WIN_W);
+	EditSession session(&te, lh, REPLAY_WIN_W, REPLAY_WIN_H);
+	session.Begin(str, strlen(str));
+	session.SetRecorder(&writer);
+
+	BenchRandom random;
+	session.Key(EDIT_KEY_DOWN);
+	for (int round = 0;round < 12;++round) {
+		for (int i = 0;i < 40;++i) {
+			const char* word = words[random.Below(sizeof(words) / sizeof(words[0]))];
+			//IME commits whole words, plain typing one character at a time
+			if (random.Below(4) == 0)
+				session.TextInput(word, strlen(word));
+			else
+				for (const char* c = word;*c != '\0';) {
+					size_t len = 1;
+					while ((static_cast<unsigned char>(c[len]) & 0xC0U) == 0x80U)
+						++len;
+					session.TextInput(c, len);
+					c += len;
+				}
+		}
+		for (int i = 0;i < 6;++i)
+			session.Key(EDIT_KEY_BACKSPACE);
+		session.Key(EDIT_KEY_RETURN);
+		session.Key(EDIT_KEY_UP);
+		session.Key(EDIT_KEY_LEFT);
+		session.Key(EDIT_KEY_RIGHT);
+		session.Key(EDIT_KEY_DOWN);
+
+		float x = static_cast<float>(random.Below(REPLAY_WIN_W));
+		float y = static_cast<float>(random.Below(REPLAY_WIN_H));
+		session.MouseDown(x, y);
+		for (int i = 0;i < 8;++i)
+			session.MouseMotion(x + i * 20, y + i * 4);
+		session.MouseWheel(-1);
+		session.MouseUp();
+		session.TextInput("X", 1);
+		session.MouseWheel(2);
+
+		if (round % 4 == 3)
+			session.Resize(REPLAY_WIN_W - 120 + static_cast<int>(random.Below(240)), REPLAY_WIN_H);
+	}
+	writer.Close();
+	return true;
+}
+
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		printf("usage: TextEngineReplay <trace> [font_dir] [repeat]\n");
+		printf("       TextEngineReplay --generate <trace> [font_dir]\n");
+		return 1;
+	}
+	bool generate = strcmp(argv[1], "--generate") == 0;
+	int arg = generate ? 2 : 1;
+	if (arg >= argc) {
+		printf("missing trace path\n");
+		return 1;
+	}
+	const char* trace_path = argv[arg];
+	const char* font_dir = argc > arg + 1 ? argv[arg + 1] : BENCH_FONT_DIR;
+	size_t repeat = argc > arg + 2 ? strtoul(argv[arg + 2], nullptr, 10) : 1;
+	if (repeat == 0)
+		repeat = 1;
+
+	if (generate) {
+		BenchEnv env;
+		if (!env.Init(font_dir, REPLAY_FONT_SIZE))
+			return 1;
+		if (!GenerateTrace(env.GetFontCollection(), trace_path)) {
+			printf("failed to write trace to %s\n", trace_path);
+			return 1;
+		}
+		printf("wrote %s\n", trace_path);
+		return 0;
+	}
+
+	EditTraceReader reader;
+	if (!reader.Open(trace_path)) {
+		printf("failed to read trace %s\n", trace_path);
+		return 1;
+	}
+	BenchEnv env;
+	if (!env.Init(font_dir, reader.GetFontHeight()))
+		return 1;
+	FontCollection* ff = env.GetFontCollection();
+
+	LatencySamples all;
+	LatencySamples per_type[EDIT_EVENT_NUM];
+	bool malformed = false;
+	uint64_t recorded_us = 0;
+	for (size_t r = 0;r < repeat;++r) {
+		TextEngine te(ff, reader.GetWindowWidth());
+		EditSession session(&te, reader.GetLineHeight(), reader.GetWindowWidth(), reader.GetWindowHeight());
+		session.Begin(reader.GetInitialText(), reader.GetInitialTextLength());
+		reader.Rewind();
+		EditEvent e;
+		while (reader.Next(e)) {
+			size_t cps = e.type == EDIT_EVENT_TEXT_INPUT ? CountUtf8Codepoints(e.text, e.text_len) : 0;
+			uint64_t start = BenchNowNs();
+			session.Apply(e);
+			uint64_t ns = BenchNowNs() - start;
+			all.Add(ns, cps);
+			per_type[e.type].Add(ns, cps);
+			recorded_us = e.time_us;
+		}
+		malformed = !reader.IsAtEnd();
+	}
+	if (malformed)
+		printf("trace ends with a malformed record, replayed the events before it\n");
+
+	printf(
+		"%s: %zu events x %zu, recorded over %.2fs, replayed in %.2fms\n\n",
+		trace_path, all.GetCount() / repeat, repeat, recorded_us / 1e6, all.GetTotalNs() / 1e6
+	);
+	PrintLatencyHeader();
+	for (int i = 0;i < EDIT_EVENT_NUM;++i)
+		if (per_type[i].GetCount() != 0)
+			PrintLatencyRow("replay", EditEventName(i), per_type[i]);
+	PrintLatencyRow("replay", "all", all);
+	printf("\n");
+	PrintLatencyHistogram(all);
+
+	env.Release();
+	return 0;
+}
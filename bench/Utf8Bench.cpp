@@ -0,0 +1,274 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+//UTF-8 codec benchmark. Compares the per codepoint UTF8Decode loop the
+//engine used to run with UTF8DecodeRange at every instruction set this CPU
+//supports, both to a plain buffer and into a CodepointArray like
+//TextEngine::Append does. The array keeps its buffers between runs, so the
+//array column leaves out the allocation of the storage. The way back is
+//UTF8Encode called per codepoint against UTF8EncodeRange and the
+//UTF8EncodedLength measurement TextEngine::GetText uses. UTF-16 input is
+//either transcoded to UTF-8 and decoded again, as embedders had to before
+//the UTF-16 overloads, or decoded by UTF16DecodeRange.
+//Usage: TextEngineUtf8Bench [megabytes]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "BenchUtils.h"
+#include "TextEngine.h"
+#include "UTF8Codec.h"
+
+#define UTF8_BENCH_REPEAT	5
+#define UTF8_BENCH_CHUNK	4096
+
+volatile uint64_t bench_sink = 0;
+
+const char* utf8_level_names[] = { "scalar", "sse4.1", "avx2" };
+
+
+//Decode loop of TextEngine::_DecodeUtf8 before UTF8DecodeRange
+void DecodeLegacy(const std::string& text, uint32_t* codepoints) {
+	const unsigned char* str = reinterpret_cast<const unsigned char*>(text.c_str());
+	int len = static_cast<int>(text.size());
+	size_t n = 0;
+	int i = 0;
+	while (i < len) {
+		uint32_t code;
+		int nb = UTF8Decode(str, i, len, code);
+		if (nb > 0) {
+			codepoints[n++] = code;
+			i += nb;
+		}
+		else
+			++i;
+	}
+	bench_sink += n;
+}
+
+
+void DecodeLegacyArray(const std::string& text, CodepointArray& cps) {
+	const unsigned char* str = reinterpret_cast<const unsigned char*>(text.c_str());
+	int len = static_cast<int>(text.size());
+	int i = 0;
+	while (i < len) {
+		uint32_t code;
+		int nb = UTF8Decode(str, i, len, code);
+		if (nb > 0) {
+			cps.Push(code);
+			i += nb;
+		}
+		else
+			++i;
+	}
+	bench_sink += cps.GetSize();
+}
+
+
+void DecodeRange(const std::string& text, uint32_t* codepoints) {
+	size_t consumed;
+	size_t n = UTF8DecodeRange(reinterpret_cast<const unsigned char*>(text.c_str()), text.size(), codepoints, text.size(), consumed);
+	bench_sink += n;
+}
+
+
+//Chunks decoded straight into the array, as TextEngine::_DecodeUtf8 does
+void DecodeRangeArray(const std::string& text, CodepointArray& cps) {
+	const unsigned char* str = reinterpret_cast<const unsigned char*>(text.c_str());
+	size_t len = text.size();
+	size_t i = 0;
+	while (i < len) {
+		size_t size = cps.GetSize();
+		size_t room = len - i < UTF8_BENCH_CHUNK ? len - i : UTF8_BENCH_CHUNK;
+		size_t consumed;
+		size_t n = UTF8DecodeRange(str + i, len - i, cps.AppendCodepoints(room), room, consumed);
+		cps.Truncate(size + n);
+		i += consumed;
+	}
+	bench_sink += cps.GetSize();
+}
+
+
+void EncodeLegacy(const std::vector<uint32_t>& codepoints, unsigned char* utf8_str) {
+	size_t j = 0;
+	for (size_t i = 0;i < codepoints.size();++i)
+		j += UTF8Encode(codepoints[i], utf8_str + j);
+	bench_sink += j;
+}
+
+
+void EncodeRange(const std::vector<uint32_t>& codepoints, unsigned char* utf8_str, size_t max_len) {
+	size_t consumed;
+	bench_sink += UTF8EncodeRange(codepoints.data(), codepoints.size(), utf8_str, max_len, consumed);
+}
+
+
+//UTF-16 to UTF-8 and back to codepoints, the round trip of an embedder
+//without the UTF-16 overloads
+void DecodeTranscoded(const std::vector<uint16_t>& utf16, unsigned char* utf8_str, uint32_t* codepoints) {
+	size_t j = 0;
+	size_t i = 0;
+	while (i < utf16.size()) {
+		uint32_t unit = utf16[i++];
+		if (unit >= 0xd800u && unit <= 0xdbffu && i < utf16.size())
+			unit = 0x10000u + ((unit - 0xd800u) << 10) + (utf16[i++] - 0xdc00u);
+		j += UTF8Encode(unit, utf8_str + j);
+	}
+	size_t consumed;
+	bench_sink += UTF8DecodeRange(utf8_str, j, codepoints, utf16.size(), consumed);
+}
+
+
+void DecodeUtf16(const std::vector<uint16_t>& utf16, uint32_t* codepoints) {
+	size_t consumed;
+	bench_sink += UTF16DecodeRange(utf16.data(), utf16.size(), codepoints, utf16.size(), consumed);
+}
+
+
+//Fastest of UTF8_BENCH_REPEAT runs in MB/s
+template<typename F>
+double MeasureMBps(size_t bytes, F run) {
+	uint64_t best = UINT64_MAX;
+	for (int r = 0;r < UTF8_BENCH_REPEAT;++r) {
+		uint64_t t0 = BenchNowNs();
+		run();
+		uint64_t ns = BenchNowNs() - t0;
+		if (ns < best)
+			best = ns;
+	}
+	return best == 0 ? 0 : bytes * 1e3 / best;
+}
+
+
+//Server log lines, the multi-megabyte ASCII case
+void BuildLog(size_t bytes, std::string& text) {
+	BenchRandom rand;
+	char line[128];
+	while (text.size() < bytes) {
+		snprintf(
+			line, sizeof(line), "2025-01-%02zu 12:%02zu:%02zu INFO worker-%zu request %u served in %zu ms\n",
+			rand.Below(28) + 1, rand.Below(60), rand.Below(60), rand.Below(16), rand.Next(), rand.Below(1000)
+		);
+		text += line;
+	}
+}
+
+
+void Repeat(const std::string& src, size_t bytes, std::string& text) {
+	while (text.size() < bytes)
+		text += src;
+}
+
+
+int main(int argc, char** argv) {
+	size_t bytes = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 4) * 1024 * 1024;
+
+	std::vector<BenchCorpus> corpus;
+	BuildBenchCorpus(corpus);
+	std::vector<std::string> names;
+	std::vector<std::string> texts;
+	names.push_back("log");
+	texts.push_back(std::string());
+	BuildLog(bytes, texts.back());
+	for (size_t i = 0;i < corpus.size();++i) {
+		names.push_back(corpus[i].name);
+		texts.push_back(std::string());
+		Repeat(corpus[i].text, bytes, texts.back());
+	}
+
+	int supported = UTF8SetSimdLevel(UTF8_SIMD_AVX2);
+	printf("%-8s %-20s %12s %8s %12s %8s\n", "input", "decoder", "cp MB/s", "speedup", "array MB/s", "speedup");
+	for (size_t t = 0;t < texts.size();++t) {
+		const std::string& text = texts[t];
+		std::vector<uint32_t> codepoints(text.size());
+		double legacy_raw = MeasureMBps(text.size(), [&]() {
+			DecodeLegacy(text, codepoints.data());
+		});
+		CodepointArray cps;
+		double legacy = MeasureMBps(text.size(), [&]() {
+			cps.Truncate(0);
+			DecodeLegacyArray(text, cps);
+		});
+		printf("%-8s %-20s %12.1f %7.2fx %12.1f %7.2fx\n", names[t].c_str(), "UTF8Decode", legacy_raw, 1.0, legacy, 1.0);
+		for (int level = UTF8_SIMD_NONE;level <= supported;++level) {
+			UTF8SetSimdLevel(level);
+			double raw = MeasureMBps(text.size(), [&]() {
+				DecodeRange(text, codepoints.data());
+			});
+			double wide = MeasureMBps(text.size(), [&]() {
+				cps.Truncate(0);
+				DecodeRangeArray(text, cps);
+			});
+			std::string name = std::string("UTF8DecodeRange/") + utf8_level_names[level];
+			printf(
+				"%-8s %-20s %12.1f %7.2fx %12.1f %7.2fx\n", names[t].c_str(), name.c_str(),
+				raw, legacy_raw == 0 ? 0 : raw / legacy_raw, wide, legacy == 0 ? 0 : wide / legacy
+			);
+		}
+	}
+
+	UTF8SetSimdLevel(UTF8_SIMD_AVX2);
+	printf("\n%-8s %-20s %12s %8s %12s\n", "input", "encoder", "MB/s", "speedup", "length MB/s");
+	for (size_t t = 0;t < texts.size();++t) {
+		const std::string& text = texts[t];
+		std::vector<uint32_t> codepoints(text.size());
+		size_t consumed;
+		size_t cp_num = UTF8DecodeRange(reinterpret_cast<const unsigned char*>(text.c_str()), text.size(), codepoints.data(), text.size(), consumed);
+		codepoints.resize(cp_num);
+		std::vector<unsigned char> utf8(text.size());
+		double legacy = MeasureMBps(text.size(), [&]() {
+			EncodeLegacy(codepoints, utf8.data());
+		});
+		printf("%-8s %-20s %12.1f %7.2fx %12s\n", names[t].c_str(), "UTF8Encode", legacy, 1.0, "-");
+		for (int level = UTF8_SIMD_NONE;level <= supported;++level) {
+			UTF8SetSimdLevel(level);
+			double encode = MeasureMBps(text.size(), [&]() {
+				EncodeRange(codepoints, utf8.data(), utf8.size());
+			});
+			double length = MeasureMBps(text.size(), [&]() {
+				bench_sink += UTF8EncodedLength(codepoints.data(), codepoints.size());
+			});
+			std::string name = std::string("UTF8EncodeRange/") + utf8_level_names[level];
+			printf(
+				"%-8s %-20s %12.1f %7.2fx %12.1f\n", names[t].c_str(), name.c_str(),
+				encode, legacy == 0 ? 0 : encode / legacy, length
+			);
+		}
+	}
+	UTF8SetSimdLevel(UTF8_SIMD_AVX2);
+	printf("\n%-8s %-24s %12s %8s\n", "input", "UTF-16 decoder", "MB/s", "speedup");
+	for (size_t t = 0;t < texts.size();++t) {
+		const std::string& text = texts[t];
+		std::vector<uint32_t> codepoints(text.size());
+		size_t consumed;
+		size_t cp_num = UTF8DecodeRange(reinterpret_cast<const unsigned char*>(text.c_str()), text.size(), codepoints.data(), text.size(), consumed);
+		std::vector<uint16_t> utf16;
+		for (size_t i = 0;i < cp_num;++i) {
+			uint32_t codepoint = codepoints[i];
+			if (codepoint >= 0x10000u) {
+				utf16.push_back(static_cast<uint16_t>(0xd800u + ((codepoint - 0x10000u) >> 10)));
+				utf16.push_back(static_cast<uint16_t>(0xdc00u + ((codepoint - 0x10000u) & 0x3ffu)));
+			}
+			else
+				utf16.push_back(static_cast<uint16_t>(codepoint));
+		}
+		size_t bytes = utf16.size() * sizeof(uint16_t);
+		std::vector<unsigned char> utf8(utf16.size() * 3);
+		codepoints.resize(utf16.size());
+		double legacy = MeasureMBps(bytes, [&]() {
+			DecodeTranscoded(utf16, utf8.data(), codepoints.data());
+		});
+		printf("%-8s %-24s %12.1f %7.2fx\n", names[t].c_str(), "via UTF-8", legacy, 1.0);
+		for (int level = UTF8_SIMD_NONE;level <= supported;++level) {
+			UTF8SetSimdLevel(level);
+			double decode = MeasureMBps(bytes, [&]() {
+				DecodeUtf16(utf16, codepoints.data());
+			});
+			std::string name = std::string("UTF16DecodeRange/") + utf8_level_names[level];
+			printf("%-8s %-24s %12.1f %7.2fx\n", names[t].c_str(), name.c_str(), decode, legacy == 0 ? 0 : decode / legacy);
+		}
+	}
+	UTF8SetSimdLevel(UTF8_SIMD_AVX2);
+	return 0;
+}
@@ -9,21 +9,46 @@
 #include "MAllocUtils.h"
 #include "ContainerUtils.h"
 
-#define BLOCKS_INCREASE_SIZE 128
+//Smallest block table once an array has more than one block, it doubles
+#define ARRAY_TABLE_MIN_SIZE 4
+//Smallest heap allocated first block, it doubles up to the block size
+#define ARRAY_HEAD_MIN_SIZE 4
 
-template<typename T>
+//Nothing is allocated until the first element is stored. The first block
+//grows geometrically up to block_size, and while the array has a single
+//block its table is a member. With N > 0 the first N elements live in the
+//array object itself.
+template<typename T, size_t N = 0>
 class Array {
+	template<typename, size_t> friend class Array;
+
 	ContainerNode<T>** block_table = nullptr;
 	size_t block_table_size = 0;
 	size_t block_num = 0;
 	size_t block_size = 0;
+	//Capacity of block 0, below block_size only while it is the only block
+	size_t head_capacity = 0;
 	size_t size = 0;
 	Copy<T> copy;
 	Deconstructor<T> deconstruct;
+	Initializer<T> initialize;
+	Mover<T> move;
+	RangeCopy<T> range_copy;
 
 	MAllocF* malloc_f = nullptr;
 	FreeF* free_f = nullptr;
 
+	ContainerNode<T>* head_slot = nullptr;
+	alignas(ContainerNode<T>) unsigned char inline_buffer[N > 0 ? N * sizeof(ContainerNode<T>) : 1];
+
+	inline ContainerNode<T>* _InlineBlock() const {
+		return reinterpret_cast<ContainerNode<T>*>(const_cast<unsigned char*>(this->inline_buffer));
+	}
+
+	inline size_t _InlineCapacity() const {
+		return N < this->block_size ? N : this->block_size;
+	}
+
 	inline ContainerNode<T>** NewBlockTable(size_t size) {
 		if (IS_NULL_POINTER(this->malloc_f))
 			return reinterpret_cast<ContainerNode<T>**>(malloc(size * sizeof(ContainerNode<T>*)));
@@ -32,27 +57,29 @@ class Array {
 
 	}
 
-	inline ContainerNode<T>* NewBlock() {
+	inline ContainerNode<T>* NewBlock(size_t len) {
 		ContainerNode<T>* ret;
 		if (IS_NULL_POINTER(this->malloc_f))
-			ret = reinterpret_cast<ContainerNode<T>*>(malloc(this->block_size * sizeof(ContainerNode<T>)));
+			ret = reinterpret_cast<ContainerNode<T>*>(malloc(len * sizeof(ContainerNode<T>)));
 		else
-			ret = reinterpret_cast<ContainerNode<T>*>(this->malloc_f(this->block_size * sizeof(ContainerNode<T>)));
-		for (size_t i = 0;i < this->block_size;++i)
-			ret[i]._node.inited = false;
+			ret = reinterpret_cast<ContainerNode<T>*>(this->malloc_f(len * sizeof(ContainerNode<T>)));
+		this->initialize(ret, len);
 		return ret;
 	}
 
 	inline void DeleteBlockTable(ContainerNode<T>** block_table) {
+		if (block_table == nullptr || block_table == &this->head_slot)
+			return;
 		if (IS_NULL_POINTER(this->free_f))
 			free(block_table);
 		else
 			this->free_f(block_table);
 	}
 
-	inline void DeleteBlock(ContainerNode<T>* block) {
-		for (size_t i = 0;i < block_size;++i)
-			this->deconstruct(block[i]);
+	inline void DeleteBlock(ContainerNode<T>* block, size_t len) {
+		this->deconstruct(block, len);
+		if (block == this->_InlineBlock())
+			return;
 		if (IS_NULL_POINTER(this->free_f))
 			free(block);
 		else
@@ -61,33 +88,126 @@ class Array {
 
 	void _Clear() {
 		this->size = 0;
-		if (this->block_table != nullptr) {
-			for (size_t i = 0;i < this->block_num;++i)
-				delete[] this->block_table[i];
-			delete[] this->block_table;
-			this->block_table = nullptr;
-			this->block_table_size = 0;
-			this->block_num = 0;
-		}
+		for (size_t i = 0;i < this->block_num;++i)
+			this->DeleteBlock(this->block_table[i], i == 0 ? this->head_capacity : this->block_size);
+		this->DeleteBlockTable(this->block_table);
+		this->block_table = nullptr;
+		this->block_table_size = 0;
+		this->block_num = 0;
+		this->head_capacity = 0;
 	}
 
-	void _BlockTableResize(size_t size) {
-		if (size == this->block_table_size)
-			return;
-		size_t actual_size = size / BLOCKS_INCREASE_SIZE + (size % BLOCKS_INCREASE_SIZE > 0 ? 1 : 0);
-		if (actual_size == 0)
-			actual_size = 1;
-		actual_size *= BLOCKS_INCREASE_SIZE;
+	//Makes room for num block pointers, a single block uses head_slot
+	void _BlockTableResize(size_t num) {
+		size_t actual_size = 1;
+		if (num > 1) {
+			actual_size = ARRAY_TABLE_MIN_SIZE;
+			while (actual_size < num)
+				actual_size *= 2;
+		}
 		if (actual_size == this->block_table_size)
 			return;
-		ContainerNode<T>** temp = this->NewBlockTable(actual_size);
-		for (size_t i = 0;i < size;++i)
+		ContainerNode<T>** temp = actual_size == 1 ? &this->head_slot : this->NewBlockTable(actual_size);
+		size_t keep = num < this->block_num ? num : this->block_num;
+		for (size_t i = 0;i < keep;++i)
 			temp[i] = this->block_table[i];
 		this->DeleteBlockTable(this->block_table);
 		this->block_table = temp;
 		this->block_table_size = actual_size;
 	}
 
+	//Capacity block 0 is given when the array needs cap <= block_size
+	size_t _HeadCapacityFor(size_t cap) const {
+		if (cap <= this->_InlineCapacity())
+			return this->_InlineCapacity();
+		size_t ret = ARRAY_HEAD_MIN_SIZE;
+		while (ret < cap)
+			ret *= 2;
+		return ret < this->block_size ? ret : this->block_size;
+	}
+
+	//Reallocates block 0 with cap elements, only while it is the only block
+	void _ResizeHead(size_t cap) {
+		if (cap == this->head_capacity)
+			return;
+		ContainerNode<T>* head = cap <= this->_InlineCapacity() ? this->_InlineBlock() : this->NewBlock(cap);
+		if (this->block_num == 0) {
+			this->_BlockTableResize(1);
+			this->block_num = 1;
+		}
+		else {
+			ContainerNode<T>* old = this->block_table[0];
+			this->move(head, old, this->size < cap ? this->size : cap);
+			this->DeleteBlock(old, this->head_capacity);
+		}
+		this->block_table[0] = head;
+		this->head_capacity = cap;
+		if (this->size > cap)
+			this->size = cap;
+	}
+
+	//Takes the blocks of other and leaves it empty, this must be empty.
+	//Elements in the inline buffer of other are moved into this one.
+	void _Take(Array<T, N>& other) {
+		if (other.block_num == 0)
+			return;
+		ContainerNode<T>* head = other.block_table[0];
+		this->block_table = other.block_table == &other.head_slot ? &this->head_slot : other.block_table;
+		this->block_table_size = other.block_table_size;
+		this->block_num = other.block_num;
+		this->head_capacity = other.head_capacity;
+		this->size = other.size;
+		if (head == other._InlineBlock()) {
+			this->move(this->_InlineBlock(), head, other.size < other.head_capacity ? other.size : other.head_capacity);
+			other.deconstruct(head, other.head_capacity);
+			head = this->_InlineBlock();
+		}
+		this->block_table[0] = head;
+		other.block_table = nullptr;
+		other.block_table_size = 0;
+		other.block_num = 0;
+		other.head_capacity = 0;
+		other.size = 0;
+	}
+
+	inline ContainerNode<T>& _Node(size_t index) const {
+		return this->block_table[index / this->block_size][index % this->block_size];
+	}
+
+	//Moves n elements from src to dst one block piece at a time, the ranges
+	//may overlap. Both must be within the capacity.
+	void _Move(size_t dst, size_t src, size_t n) {
+		if (n == 0 || dst == src)
+			return;
+		size_t bs = this->block_size;
+		if (dst < src) {
+			for (size_t done = 0;done < n;) {
+				size_t d = dst + done;
+				size_t s = src + done;
+				size_t chunk = n - done;
+				if (chunk > bs - d % bs)
+					chunk = bs - d % bs;
+				if (chunk > bs - s % bs)
+					chunk = bs - s % bs;
+				this->move(&this->_Node(d), &this->_Node(s), chunk);
+				done += chunk;
+			}
+		}
+		else {
+			for (size_t left = n;left > 0;) {
+				size_t d_end = dst + left;
+				size_t s_end = src + left;
+				size_t chunk = left;
+				if (chunk > (d_end - 1) % bs + 1)
+					chunk = (d_end - 1) % bs + 1;
+				if (chunk > (s_end - 1) % bs + 1)
+					chunk = (s_end - 1) % bs + 1;
+				this->move(&this->_Node(d_end - chunk), &this->_Node(s_end - chunk), chunk);
+				left -= chunk;
+			}
+		}
+	}
+
 public:
 	Array(
 		size_t block_size = 128, 
@@ -95,29 +215,68 @@ public:
 		FreeF* free_f = nullptr
 	): 
 		block_size(block_size), malloc_f(malloc_f), free_f(free_f) {
-		this->Clear();
+		if (N > 0)
+			this->initialize(this->_InlineBlock(), N);
+	}
+
+	Array(const Array<T, N>&) = delete;
+	Array<T, N>& operator=(const Array<T, N>&) = delete;
+
+	//Takes the blocks of other, which is left empty
+	Array(Array<T, N>&& other):
+		block_size(other.block_size), malloc_f(other.malloc_f), free_f(other.free_f) {
+		if (N > 0)
+			this->initialize(this->_InlineBlock(), N);
+		this->_Take(other);
+	}
+
+	Array<T, N>& operator=(Array<T, N>&& other) {
+		if (this == &other)
+			return *this;
+		this->_Clear();
+		this->block_size = other.block_size;
+		this->malloc_f = other.malloc_f;
+		this->free_f = other.free_f;
+		this->_Take(other);
+		return *this;
 	}
 
 	size_t GetCapacity() const {
-		return this->block_num * this->block_size;
+		if (this->block_num == 0)
+			return 0;
+		return this->head_capacity + (this->block_num - 1) * this->block_size;
 	}
 
+	//Rounds up, to a power of two while a single block is enough
 	void SetCapacity(size_t cap) {
-		size_t new_block_num = cap / this->block_size + (cap % this->block_size > 0 ? 1 : 0);
-		if (new_block_num == 0)
-			new_block_num = 1;
-		if (new_block_num > this->block_num) {
-			this->_BlockTableResize(new_block_num);
-			size_t n = new_block_num - this->block_num;
-			for (size_t i = this->block_num;i < new_block_num;++i)
-				this->block_table[i] = this->NewBlock();
-		}
-		else if (new_block_num < this->block_num) {
-			for (size_t i = new_block_num;i < this->block_num;++i)
-				this->DeleteBlock(this->block_table[i]);
-			this->_BlockTableResize(new_block_num);
-		}
-		this->block_num = new_block_num;
+		if (cap == 0) {
+			this->_Clear();
+			return;
+		}
+		if (cap <= this->block_size) {
+			for (size_t i = 1;i < this->block_num;++i)
+				this->DeleteBlock(this->block_table[i], this->block_size);
+			if (this->block_num > 1) {
+				this->_BlockTableResize(1);
+				this->block_num = 1;
+			}
+			this->_ResizeHead(this->_HeadCapacityFor(cap));
+		}
+		else {
+			size_t new_block_num = cap / this->block_size + (cap % this->block_size > 0 ? 1 : 0);
+			this->_ResizeHead(this->block_size);
+			if (new_block_num > this->block_num) {
+				this->_BlockTableResize(new_block_num);
+				for (size_t i = this->block_num;i < new_block_num;++i)
+					this->block_table[i] = this->NewBlock(this->block_size);
+			}
+			else if (new_block_num < this->block_num) {
+				for (size_t i = new_block_num;i < this->block_num;++i)
+					this->DeleteBlock(this->block_table[i], this->block_size);
+				this->_BlockTableResize(new_block_num);
+			}
+			this->block_num = new_block_num;
+		}
 		if (cap < this->size)
 			this->size = cap;
 	}
@@ -130,23 +289,41 @@ public:
 		if (this->size > 0)
 			--this->size;
 	}
+
+	//Shrinks the size, blocks are kept for the next Push
+	void Truncate(size_t size) {
+		if (size < this->size)
+			this->size = size;
+	}
 	
 	void Push(const T& value) {
 		this->Set(this->size, value);
 	}
 
+	void Push(T&& value) {
+		this->Set(this->size, std::move(value));
+	}
+
+	//Constructs the new last element from args in place
+	template<typename... Args>
+	T& Emplace(Args&&... args) {
+		size_t index = this->size;
+		if (index >= this->GetCapacity())
+			this->SetCapacity(index + 1);
+		this->copy.Emplace(this->_Node(index), std::forward<Args>(args)...);
+		this->size = index + 1;
+		return this->_Node(index)._node.data;
+	}
+
+	//Frees every block, the array allocates again on the next store
 	void Clear() {
 		this->_Clear();
-		this->block_table = this->NewBlockTable(BLOCKS_INCREASE_SIZE);
-		this->block_table_size = BLOCKS_INCREASE_SIZE;
-		this->block_table[0] = this->NewBlock();
-		this->block_num = 1;
 	}
 
 	T& Get(size_t index) const {
 		if (index >= this->size)
 			throw std::out_of_range("Array index out of range");
-		return this->block_table[index / this->block_size][index % this->block_size]._node.data;
+		return this->_Node(index)._node.data;
 	}
 
 	void Set(size_t index, const T& value) {
@@ -154,29 +331,197 @@ public:
 			this->SetCapacity(index + 1);
 		if (index >= this->size)
 			this->size = index + 1;
-		this->copy(this->block_table[index / this->block_size][index % this->block_size], value);
+		this->copy(this->_Node(index), value);
+	}
+
+	void Set(size_t index, T&& value) {
+		if (index >= this->GetCapacity())
+			this->SetCapacity(index + 1);
+		if (index >= this->size)
+			this->size = index + 1;
+		this->copy(this->_Node(index), std::move(value));
 	}
 
+	//Inserts value before index, index may be the size
 	void Insert(size_t index, const T& value) {
-		if(index >= this->size)
+		if(index > this->size)
 			throw std::out_of_range("Array index out of range");
-		for (size_t i = this->size - 1;i >= index;) {
-			this->Set(i + 1, this->Get(i));
-			if (i == 0)
-				break;
-			--i;
-		}
-		this->Set(index, value);
+		if (this->size + 1 > this->GetCapacity())
+			this->SetCapacity(this->size + 1);
+		this->_Move(index + 1, index, this->size - index);
+		++this->size;
+		this->copy(this->_Node(index), value);
+	}
+
+	void Insert(size_t index, T&& value) {
+		if(index > this->size)
+			throw std::out_of_range("Array index out of range");
+		if (this->size + 1 > this->GetCapacity())
+			this->SetCapacity(this->size + 1);
+		this->_Move(index + 1, index, this->size - index);
+		++this->size;
+		this->copy(this->_Node(index), std::move(value));
 	}
 
 	void Remove(size_t index) {
 		if (index >= this->size)
 			throw std::out_of_range("Array index out of range");
-		for (size_t i = index + 1;i < this->size;++i)
-			this->Set(i - 1, this->Get(i));
+		this->_Move(index, index + 1, this->size - index - 1);
 		--this->size;
 	}
 
+	//Inserts n elements of src starting at start before index, index may be
+	//the size. src must not be this array.
+	template<size_t M>
+	void InsertRange(size_t index, const Array<T, M>& src, size_t start, size_t n) {
+		if (index > this->size || start + n > src.size)
+			throw std::out_of_range("Array index out of range");
+		if (n == 0)
+			return;
+		if (this->size + n > this->GetCapacity())
+			this->SetCapacity(this->size + n);
+		this->_Move(index + n, index, this->size - index);
+		this->size += n;
+		size_t bs = this->block_size;
+		size_t sbs = src.block_size;
+		for (size_t done = 0;done < n;) {
+			size_t d = index + done;
+			size_t s = start + done;
+			size_t chunk = n - done;
+			if (chunk > bs - d % bs)
+				chunk = bs - d % bs;
+			if (chunk > sbs - s % sbs)
+				chunk = sbs - s % sbs;
+			this->range_copy(&this->_Node(d), &src._Node(s), chunk);
+			done += chunk;
+		}
+	}
+
+	void InsertRange(size_t index, const T* values, size_t n) {
+		if (index > this->size)
+			throw std::out_of_range("Array index out of range");
+		if (n == 0)
+			return;
+		if (this->size + n > this->GetCapacity())
+			this->SetCapacity(this->size + n);
+		this->_Move(index + n, index, this->size - index);
+		this->size += n;
+		for (size_t i = 0;i < n;++i)
+			this->copy(this->_Node(index + i), values[i]);
+	}
+
+	template<size_t M>
+	void AppendRange(const Array<T, M>& src, size_t start, size_t n) {
+		this->InsertRange(this->size, src, start, n);
+	}
+
+	void AppendRange(const T* values, size_t n) {
+		this->InsertRange(this->size, values, n);
+	}
+
+	//Removes n elements starting at index, capacity is kept
+	void RemoveRange(size_t index, size_t n) {
+		if (index + n > this->size)
+			throw std::out_of_range("Array index out of range");
+		this->_Move(index, index + n, this->size - index - n);
+		this->size -= n;
+	}
+
+	//No range check, index must already be below the size
+	inline T& GetUnchecked(size_t index) const {
+		return this->_Node(index)._node.data;
+	}
+
+	//Calls f(T* data, size_t len) for every contiguous block piece of
+	//[start, start + n), in order. Only for elements stored without a flag.
+	template<typename F>
+	void ForEachSpan(size_t start, size_t n, F f) const {
+		static_assert(CONTAINER_IS_TRIVIAL(T) && sizeof(ContainerNode<T>) == sizeof(T), "Array span needs plain elements");
+		if (start + n > this->size)
+			throw std::out_of_range("Array index out of range");
+		size_t bs = this->block_size;
+		for (size_t done = 0;done < n;) {
+			size_t s = start + done;
+			size_t chunk = n - done;
+			if (chunk > bs - s % bs)
+				chunk = bs - s % bs;
+			f(&this->_Node(s)._node.data, chunk);
+			done += chunk;
+		}
+	}
+
+	template<typename F>
+	void ForEachSpan(F f) const {
+		this->ForEachSpan(0, this->size, f);
+	}
+
+	//Grows the size by n and calls f(T* data, size_t len) for every block
+	//piece of the new elements, which f must all write
+	template<typename F>
+	void AppendSpans(size_t n, F f) {
+		size_t start = this->size;
+		if (start + n > this->GetCapacity())
+			this->SetCapacity(start + n);
+		this->size = start + n;
+		this->ForEachSpan(start, n, f);
+	}
+
+	//Forward iterator, the block is only looked up when the index crosses into it
+	class Iterator {
+		ContainerNode<T>** block_table;
+		size_t block_size;
+		size_t index;
+		size_t end;
+		ContainerNode<T>* node;
+
+	public:
+		Iterator(ContainerNode<T>** block_table, size_t block_size, size_t index, size_t end):
+			block_table(block_table), block_size(block_size), index(index), end(end), node(nullptr) {
+			if (index < end)
+				this->node = &block_table[index / block_size][index % block_size];
+		}
+
+		T& operator*() const {
+			return this->node->_node.data;
+		}
+
+		T* operator->() const {
+			return &this->node->_node.data;
+		}
+
+		Iterator& operator++() {
+			++this->index;
+			if (this->index < this->end) {
+				if (this->index % this->block_size == 0)
+					this->node = this->block_table[this->index / this->block_size];
+				else
+					++this->node;
+			}
+			return *this;
+		}
+
+		bool operator==(const Iterator& other) const {
+			return this->index == other.index;
+		}
+
+		bool operator!=(const Iterator& other) const {
+			return this->index != other.index;
+		}
+
+		size_t GetIndex() const {
+			return this->index;
+		}
+	};
+
+	//Lower case so range based for works
+	Iterator begin() const {
+		return Iterator(this->block_table, this->block_size, 0, this->size);
+	}
+
+	Iterator end() const {
+		return Iterator(this->block_table, this->block_size, this->size, this->size);
+	}
+
 	~Array() {
 		this->_Clear();
 	}
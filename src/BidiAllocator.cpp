@@ -0,0 +1,35 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "MemoryStats.h"
+#include <SheenBidi/SheenBidi.h>
+
+
+void* BidiAllocateBlock(SBUInteger size, void*) {
+	return MemoryAlloc(MEMORY_CATEGORY_BIDI, size);
+}
+
+
+void* BidiReallocateBlock(void* pointer, SBUInteger size, void*) {
+	return MemoryRealloc(pointer, size);
+}
+
+
+void BidiDeallocateBlock(void* pointer, void*) {
+	MemoryRelease(pointer);
+}
+
+
+void MemoryInstallBidiAllocator() {
+	static SBAllocatorRef bidi_allocator = nullptr;
+	if (bidi_allocator != nullptr)
+		return;
+	SBAllocatorProtocol protocol = {
+		BidiAllocateBlock,
+		BidiReallocateBlock,
+		BidiDeallocateBlock,
+		nullptr
+	};
+	bidi_allocator = SBAllocatorCreate(&protocol, nullptr);
+	SBAllocatorSetDefault(bidi_allocator);
+}
@@ -0,0 +1,136 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "CodepointArray.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+
+CodepointArray::CodepointArray(MAllocF* malloc_f, FreeF* free_f):malloc_f(malloc_f), free_f(free_f) {}
+
+
+CodepointArray::~CodepointArray() {
+	this->Clear();
+}
+
+
+//Doubles the capacity until size fits
+void CodepointArray::_Reserve(size_t size) {
+	if (size <= this->capacity)
+		return;
+	size_t cap = this->capacity < CP_ARRAY_MIN_CAPACITY ? CP_ARRAY_MIN_CAPACITY : this->capacity;
+	while (cap < size)
+		cap *= 2;
+	this->SetCapacity(cap);
+}
+
+
+//The ranges may overlap, both must be within the capacity
+void CodepointArray::_Move(size_t dst, size_t src, size_t n) {
+	if (n == 0 || dst == src)
+		return;
+	memmove(this->codepoints + dst, this->codepoints + src, n * sizeof(uint32_t));
+	memmove(this->maps + dst, this->maps + src, n * sizeof(CPMap));
+	memmove(this->flags + dst, this->flags + src, n * sizeof(uint8_t));
+}
+
+
+void CodepointArray::_Copy(size_t dst, const CodepointArray& src, size_t start, size_t n) {
+	memcpy(this->codepoints + dst, src.codepoints + start, n * sizeof(uint32_t));
+	memcpy(this->maps + dst, src.maps + start, n * sizeof(CPMap));
+	memcpy(this->flags + dst, src.flags + start, n * sizeof(uint8_t));
+}
+
+
+//The arrays follow each other in the allocation, largest alignment first
+void CodepointArray::SetCapacity(size_t cap) {
+	if (cap == this->capacity)
+		return;
+	if (cap == 0) {
+		this->Clear();
+		return;
+	}
+	size_t bytes = cap * CP_ARRAY_ELEMENT_SIZE;
+	unsigned char* data;
+	if (IS_NULL_POINTER(this->malloc_f))
+		data = reinterpret_cast<unsigned char*>(malloc(bytes));
+	else
+		data = reinterpret_cast<unsigned char*>(this->malloc_f(bytes));
+	uint32_t* codepoints = reinterpret_cast<uint32_t*>(data);
+	CPMap* maps = reinterpret_cast<CPMap*>(data + cap * sizeof(uint32_t));
+	uint8_t* flags = reinterpret_cast<uint8_t*>(data + cap * (sizeof(uint32_t) + sizeof(CPMap)));
+	size_t keep = this->size < cap ? this->size : cap;
+	if (keep > 0) {
+		memcpy(codepoints, this->codepoints, keep * sizeof(uint32_t));
+		memcpy(maps, this->maps, keep * sizeof(CPMap));
+		memcpy(flags, this->flags, keep * sizeof(uint8_t));
+	}
+	size_t size = keep;
+	this->Clear();
+	this->data = data;
+	this->codepoints = codepoints;
+	this->maps = maps;
+	this->flags = flags;
+	this->size = size;
+	this->capacity = cap;
+}
+
+
+void CodepointArray::Clear() {
+	if (this->data != nullptr) {
+		if (IS_NULL_POINTER(this->free_f))
+			free(this->data);
+		else
+			this->free_f(this->data);
+	}
+	this->data = nullptr;
+	this->codepoints = nullptr;
+	this->maps = nullptr;
+	this->flags = nullptr;
+	this->size = 0;
+	this->capacity = 0;
+}
+
+
+uint32_t* CodepointArray::AppendCodepoints(size_t n) {
+	this->_Reserve(this->size + n);
+	uint32_t* ret = this->codepoints + this->size;
+	if (n > 0)
+		memset(this->flags + this->size, 0, n * sizeof(uint8_t));
+	this->size += n;
+	return ret;
+}
+
+
+//src must not be this array
+void CodepointArray::InsertRange(size_t index, const CodepointArray& src, size_t start, size_t n) {
+	if (index > this->size || start + n > src.size)
+		throw std::out_of_range("CodepointArray index out of range");
+	if (n == 0)
+		return;
+	this->_Reserve(this->size + n);
+	this->_Move(index + n, index, this->size - index);
+	this->_Copy(index, src, start, n);
+	this->size += n;
+}
+
+
+void CodepointArray::AppendRange(const CodepointArray& src, size_t start, size_t n) {
+	this->InsertRange(this->size, src, start, n);
+}
+
+
+//Capacity is kept
+void CodepointArray::RemoveRange(size_t index, size_t n) {
+	if (index + n > this->size)
+		throw std::out_of_range("CodepointArray index out of range");
+	this->_Move(index, index + n, this->size - index - n);
+	this->size -= n;
+}
+
+
+uint32_t CodepointAt(const void* cps, size_t index) {
+	//Called with indices below the length the caller was given
+	return reinterpret_cast<const CodepointArray*>(cps)->GetCodepointUnchecked(index);
+}
@@ -0,0 +1,129 @@
+#ifndef CODEPOINT_ARRAY_H
+#define CODEPOINT_ARRAY_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "MAllocUtils.h"
+
+//Smallest capacity once a codepoint is stored, it doubles from there
+#define CP_ARRAY_MIN_CAPACITY	4
+
+//Glyphs of the line a mapped codepoint starts the cluster of
+struct CPMap {
+	uint32_t line;
+	uint32_t start;
+	uint32_t len;
+};
+
+//Bytes a codepoint takes in a CodepointArray
+#define CP_ARRAY_ELEMENT_SIZE	(sizeof(uint32_t) + sizeof(CPMap) + sizeof(uint8_t))
+
+
+//Codepoints of a paragraph as parallel arrays in one allocation: a plain
+//UTF-32 buffer SheenBidi, the line breaker and the codec read directly, the
+//CP_FLAG_* byte of each, and the cluster map only CP_FLAG_MAPPED ones fill
+//in. Any store may move the buffers, Truncate keeps them.
+class CodepointArray {
+	unsigned char* data = nullptr;
+	uint32_t* codepoints = nullptr;
+	CPMap* maps = nullptr;
+	uint8_t* flags = nullptr;
+	size_t size = 0;
+	size_t capacity = 0;
+
+	MAllocF* malloc_f = nullptr;
+	FreeF* free_f = nullptr;
+
+	void _Reserve(size_t size);
+	void _Move(size_t dst, size_t src, size_t n);
+	void _Copy(size_t dst, const CodepointArray& src, size_t start, size_t n);
+
+public:
+	CodepointArray(MAllocF* malloc_f = nullptr, FreeF* free_f = nullptr);
+	CodepointArray(const CodepointArray&) = delete;
+	CodepointArray& operator=(const CodepointArray&) = delete;
+	~CodepointArray();
+
+	size_t GetSize() const {
+		return this->size;
+	}
+
+	size_t GetCapacity() const {
+		return this->capacity;
+	}
+
+	//Exactly cap, the size is cut if it does not fit
+	void SetCapacity(size_t cap);
+	//Shrinks the size, the buffers are kept for the next store
+	void Truncate(size_t size) {
+		if (size < this->size)
+			this->size = size;
+	}
+
+	//Frees the buffers
+	void Clear();
+
+	const uint32_t* GetCodepointBuffer() const {
+		return this->codepoints;
+	}
+
+	uint8_t* GetFlagBuffer() const {
+		return this->flags;
+	}
+
+	uint32_t GetCodepoint(size_t index) const {
+		if (index >= this->size)
+			throw std::out_of_range("CodepointArray index out of range");
+		return this->codepoints[index];
+	}
+
+	uint8_t& GetFlags(size_t index) const {
+		if (index >= this->size)
+			throw std::out_of_range("CodepointArray index out of range");
+		return this->flags[index];
+	}
+
+	CPMap& GetMap(size_t index) const {
+		if (index >= this->size)
+			throw std::out_of_range("CodepointArray index out of range");
+		return this->maps[index];
+	}
+
+	//No range check, index must already be below the size
+	inline uint32_t GetCodepointUnchecked(size_t index) const {
+		return this->codepoints[index];
+	}
+
+	inline uint8_t& GetFlagsUnchecked(size_t index) const {
+		return this->flags[index];
+	}
+
+	inline CPMap& GetMapUnchecked(size_t index) const {
+		return this->maps[index];
+	}
+
+	void Push(uint32_t codepoint, uint8_t flags = 0) {
+		if (this->size == this->capacity)
+			this->_Reserve(this->size + 1);
+		this->codepoints[this->size] = codepoint;
+		this->flags[this->size] = flags;
+		++this->size;
+	}
+
+	//Adds n codepoints without flags and returns them to be written
+	uint32_t* AppendCodepoints(size_t n);
+	void InsertRange(size_t index, const CodepointArray& src, size_t start, size_t n);
+	void AppendRange(const CodepointArray& src, size_t start, size_t n);
+	void RemoveRange(size_t index, size_t n);
+};
+
+
+//For SheenBidi and LineBreaker callers that need a sequence which stays
+//valid while it grows, cps is a CodepointArray
+uint32_t CodepointAt(const void* cps, size_t index);
+
+#endif
@@ -4,7 +4,14 @@
 //Copyright (C) 2025 Hongyi Chen (BeanPieChen)
 //Licensed under the MIT License
 
+#include <cstddef>
+#include <cstring>
+#include <new>
 #include <type_traits>
+#include <utility>
+
+//Elements copied with memcpy/memmove, no inited flag and no destructor call
+#define CONTAINER_IS_TRIVIAL(T) (std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value)
 
 template<typename T,bool f>
 struct _ContainerNode {
@@ -27,7 +34,7 @@ struct _ContainerNode<T, false> {
 
 template<typename T>
 struct ContainerNode {
-	_ContainerNode<T, std::is_fundamental<T>::value&& std::is_pointer<T>::value> _node;
+	_ContainerNode<T, CONTAINER_IS_TRIVIAL(T)> _node;
 };
 
 
@@ -43,6 +50,10 @@ public:
 	void operator()(ContainerNode<T>& node, const T& other) {
 		node._node.data = other;
 	}
+	template<typename... Args>
+	void Emplace(ContainerNode<T>& node, Args&&... args) {
+		new(&(node._node.data)) T(std::forward<Args>(args)...);
+	}
 };
 
 template<typename T>
@@ -55,17 +66,41 @@ public:
 			new(&(node._node.data)) T(other);
 		node._node.inited = true;
 	}
+	void operator()(ContainerNode<T>& node, T&& other) {
+		if (node._node.inited)
+			node._node.data = std::move(other);
+		else
+			new(&(node._node.data)) T(std::move(other));
+		node._node.inited = true;
+	}
+	//Destroys the old element if any, then constructs from args in place
+	template<typename... Args>
+	void Emplace(ContainerNode<T>& node, Args&&... args) {
+		if (node._node.inited) {
+			node._node.data.~T();
+			node._node.inited = false;
+		}
+		new(&(node._node.data)) T(std::forward<Args>(args)...);
+		node._node.inited = true;
+	}
 };
 
 
 template<typename T>
 class Copy {
-	_Copy<T, std::is_fundamental<T>::value&& std::is_pointer<T>::value> copy;
+	_Copy<T, CONTAINER_IS_TRIVIAL(T)> copy;
 
 public:
 	void operator()(ContainerNode<T>& node, const T& other) {
 		this->copy(node, other);
 	}
+	void operator()(ContainerNode<T>& node, T&& other) {
+		this->copy(node, std::move(other));
+	}
+	template<typename... Args>
+	void Emplace(ContainerNode<T>& node, Args&&... args) {
+		this->copy.Emplace(node, std::forward<Args>(args)...);
+	}
 };
 
 
@@ -78,7 +113,10 @@ class _Deconstructor {
 template<typename T>
 class _Deconstructor<T, true> {
 public:
-	void operator()(ContainerNode<T>& node) {
+	void operator()(ContainerNode<T>&) {
+		//Do nothing
+	}
+	void operator()(ContainerNode<T>*, size_t) {
 		//Do nothing
 	}
 };
@@ -93,16 +131,147 @@ public:
 			node._node.inited = false;
 		}
 	}
+	void operator()(ContainerNode<T>* nodes, size_t n) {
+		for (size_t i = 0;i < n;++i)
+			this->operator()(nodes[i]);
+	}
 };
 
 
 template<typename T>
 class Deconstructor {
-	_Deconstructor<T, std::is_fundamental<T>::value&& std::is_pointer<T>::value> deconstructor;
+	_Deconstructor<T, CONTAINER_IS_TRIVIAL(T)> deconstructor;
 
 public:
 	void operator()(ContainerNode<T>& obj) {
 		this->deconstructor(obj);
 	}
+	void operator()(ContainerNode<T>* nodes, size_t n) {
+		this->deconstructor(nodes, n);
+	}
+};
+
+
+//Marks freshly allocated raw nodes as holding no element
+template<typename T, bool f>
+class _Initializer {
+
+};
+
+
+template<typename T>
+class _Initializer<T, true> {
+public:
+	void operator()(ContainerNode<T>*, size_t) {
+		//Do nothing
+	}
+};
+
+
+template<typename T>
+class _Initializer<T, false> {
+public:
+	void operator()(ContainerNode<T>* nodes, size_t n) {
+		for (size_t i = 0;i < n;++i)
+			nodes[i]._node.inited = false;
+	}
+};
+
+
+template<typename T>
+class Initializer {
+	_Initializer<T, CONTAINER_IS_TRIVIAL(T)> initializer;
+
+public:
+	void operator()(ContainerNode<T>* nodes, size_t n) {
+		this->initializer(nodes, n);
+	}
+};
+
+
+//Moves n nodes from src to dst, the ranges may overlap. The source
+//elements are left moved from, not destroyed.
+template<typename T, bool f>
+class _Mover {
+
+};
+
+
+template<typename T>
+class _Mover<T, true> {
+public:
+	void operator()(ContainerNode<T>* dst, const ContainerNode<T>* src, size_t n) {
+		if (n > 0)
+			memmove(dst, src, n * sizeof(ContainerNode<T>));
+	}
+};
+
+
+template<typename T>
+class _Mover<T, false> {
+	_Copy<T, false> copy;
+
+public:
+	void operator()(ContainerNode<T>* dst, ContainerNode<T>* src, size_t n) {
+		if (dst < src) {
+			for (size_t i = 0;i < n;++i)
+				this->copy(dst[i], std::move(src[i]._node.data));
+		}
+		else if (dst > src) {
+			for (size_t i = n;i > 0;--i)
+				this->copy(dst[i - 1], std::move(src[i - 1]._node.data));
+		}
+	}
+};
+
+
+template<typename T>
+class Mover {
+	_Mover<T, CONTAINER_IS_TRIVIAL(T)> mover;
+
+public:
+	void operator()(ContainerNode<T>* dst, ContainerNode<T>* src, size_t n) {
+		this->mover(dst, src, n);
+	}
+};
+
+
+//Copies n nodes from src to dst, the ranges must not overlap
+template<typename T, bool f>
+class _RangeCopy {
+
+};
+
+
+template<typename T>
+class _RangeCopy<T, true> {
+public:
+	void operator()(ContainerNode<T>* dst, const ContainerNode<T>* src, size_t n) {
+		if (n > 0)
+			memcpy(dst, src, n * sizeof(ContainerNode<T>));
+	}
+};
+
+
+template<typename T>
+class _RangeCopy<T, false> {
+	_Copy<T, false> copy;
+
+public:
+	void operator()(ContainerNode<T>* dst, const ContainerNode<T>* src, size_t n) {
+		for (size_t i = 0;i < n;++i)
+			this->copy(dst[i], src[i]._node.data);
+	}
+};
+
+
+template<typename T>
+class RangeCopy {
+	_RangeCopy<T, CONTAINER_IS_TRIVIAL(T)> range_copy;
+
+public:
+	void operator()(ContainerNode<T>* dst, const ContainerNode<T>* src, size_t n) {
+		this->range_copy(dst, src, n);
+	}
 };
 #endif 
\ No newline at end of file
@@ -6,67 +6,13 @@
 #include <limits.h> // INT_MAX
 
 #include "CubeAtlas.h"
-#include "Array.h"
-
-class RectanglePacker
-{
-public:
-	RectanglePacker();
-	RectanglePacker(uint32_t _width, uint32_t _height);
-
-	/// non constructor initialization
-	void init(uint32_t _width, uint32_t _height);
-
-	/// find a suitable position for the given rectangle
-	/// @return true if the rectangle can be added, false otherwise
-	bool addRectangle(uint16_t _width, uint16_t _height, uint16_t& _outX, uint16_t& _outY);
-
-	/// return the used surface in squared unit
-	uint32_t getUsedSurface()
-	{
-		return m_usedSpace;
-	}
-
-	/// return the total available surface in squared unit
-	uint32_t getTotalSurface()
-	{
-		return m_width * m_height;
-	}
-
-	/// return the usage ratio of the available surface [0:1]
-	float getUsageRatio();
-
-	/// reset to initial state
-	void clear();
-
-private:
-	int32_t fit(uint32_t _skylineNodeIndex, uint16_t _width, uint16_t _height);
-
-	/// Merges all skyline nodes that are at the same level.
-	void merge();
-
-	struct Node
-	{
-		Node(int16_t _x, int16_t _y, int16_t _width) : x(_x), y(_y), width(_width)
-		{
-		}
-
-		int16_t x;     //< The starting x-coordinate (leftmost).
-		int16_t y;     //< The y-coordinate of the skyline level line.
-		int32_t width; //< The line _width. The ending coordinate (inclusive) will be x+width-1.
-	};
-
-
-	uint32_t m_width;            //< width (in pixels) of the underlying texture
-	uint32_t m_height;           //< height (in pixels) of the underlying texture
-	uint32_t m_usedSpace;        //< Surface used in squared pixel
-	Array<Node> m_skyline; //< node of the skyline algorithm
-};
+#include "TraceRecorder.h"
 
 RectanglePacker::RectanglePacker()
 	: m_width(0)
 	, m_height(0)
 	, m_usedSpace(0)
+	, m_skyline(128, MEMORY_HOOKS(MEMORY_CATEGORY_ATLAS))
 {
 }
 
@@ -74,6 +20,7 @@ RectanglePacker::RectanglePacker(uint32_t _width, uint32_t _height)
 	: m_width(_width)
 	, m_height(_height)
 	, m_usedSpace(0)
+	, m_skyline(128, MEMORY_HOOKS(MEMORY_CATEGORY_ATLAS))
 {
 	// We want a one pixel border around the whole atlas to avoid any artefact when
 	// sampling texture
@@ -241,6 +188,7 @@ void RectanglePacker::merge()
 
 struct Atlas::PackedLayer
 {
+	MEMORY_TRACKED_NEW(MEMORY_CATEGORY_ATLAS)
 	RectanglePacker packer;
 	AtlasRegion faceRegion;
 };
@@ -265,27 +213,30 @@ Atlas::Atlas(uint16_t atlas_size, uint16_t max_region_num, bool is_bgra)
 	for (int ii = 0; ii < 6; ++ii)
 		this->layers[ii].packer.init(atlas_size, atlas_size);
 
-	this->regions = new AtlasRegion[max_region_num];
+	this->regions = reinterpret_cast<AtlasRegion*>(MemoryAllocOrThrow(MEMORY_CATEGORY_ATLAS, max_region_num * sizeof(AtlasRegion)));
 
-	if (is_bgra) {
-		this->atlas_buffer = new uint8_t[atlas_size * atlas_size * 6 * 4];
-		MemSet(this->atlas_buffer, 0, atlas_size * atlas_size * 6 * 4);
-	}
-	else {
-		this->atlas_buffer = new uint8_t[atlas_size * atlas_size * 6];
-		MemSet(this->atlas_buffer, 0, atlas_size * atlas_size * 6);
-	}
+	this->atlas_buffer = reinterpret_cast<uint8_t*>(MemoryAllocOrThrow(MEMORY_CATEGORY_ATLAS, this->getTextureBufferSize()));
+	MemSet(this->atlas_buffer, 0, this->getTextureBufferSize());
 }
 
 
 Atlas::~Atlas() {
 	delete [] this->layers;
-	delete [] this->regions;
-	delete [] this->atlas_buffer;
+	MemoryRelease(this->regions);
+	MemoryRelease(this->atlas_buffer);
+}
+
+
+uint32_t Atlas::getUsedSurface() const {
+	uint32_t ret = 0;
+	for (int ii = 0; ii < 6; ++ii)
+		ret += this->layers[ii].packer.getUsedSurface();
+	return ret;
 }
 
 
 uint16_t Atlas::addRegion(uint16_t width, uint16_t height, const uint8_t* bitmap_buffer, uint16_t margin) {
+	TRACE_SPAN("Atlas::addRegion");
 	if (this->region_num >= this->max_region_num)
 		return UINT16_MAX;
 
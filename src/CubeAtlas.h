@@ -7,6 +7,8 @@
 #define CUBE_ATLAS_H
 
 #include <cstdint>
+#include "Array.h"
+#include "MemoryStats.h"
 
 #define MAX_REGION_NUM 4096
 
@@ -19,6 +21,62 @@
 /// algorithm based on C++ sources provided by Jukka Jylänki at:
 /// http://clb.demon.fi/files/RectangleBinPack/
 
+/// Skyline packer of a single atlas face
+class RectanglePacker
+{
+public:
+	RectanglePacker();
+	RectanglePacker(uint32_t _width, uint32_t _height);
+
+	/// non constructor initialization
+	void init(uint32_t _width, uint32_t _height);
+
+	/// find a suitable position for the given rectangle
+	/// @return true if the rectangle can be added, false otherwise
+	bool addRectangle(uint16_t _width, uint16_t _height, uint16_t& _outX, uint16_t& _outY);
+
+	/// return the used surface in squared unit
+	uint32_t getUsedSurface() const
+	{
+		return m_usedSpace;
+	}
+
+	/// return the total available surface in squared unit
+	uint32_t getTotalSurface()
+	{
+		return m_width * m_height;
+	}
+
+	/// return the usage ratio of the available surface [0:1]
+	float getUsageRatio();
+
+	/// reset to initial state
+	void clear();
+
+private:
+	int32_t fit(uint32_t _skylineNodeIndex, uint16_t _width, uint16_t _height);
+
+	/// Merges all skyline nodes that are at the same level.
+	void merge();
+
+	struct Node
+	{
+		Node(int16_t _x, int16_t _y, int16_t _width) : x(_x), y(_y), width(_width)
+		{
+		}
+
+		int16_t x;     //< The starting x-coordinate (leftmost).
+		int16_t y;     //< The y-coordinate of the skyline level line.
+		int32_t width; //< The line _width. The ending coordinate (inclusive) will be x+width-1.
+	};
+
+
+	uint32_t m_width;            //< width (in pixels) of the underlying texture
+	uint32_t m_height;           //< height (in pixels) of the underlying texture
+	uint32_t m_usedSpace;        //< Surface used in squared pixel
+	Array<Node> m_skyline; //< node of the skyline algorithm
+};
+
 struct AtlasRegion
 {
 	uint16_t x, y;
@@ -33,6 +91,8 @@ class Atlas
 		0,0,0,0,0
 	};
 public:
+	MEMORY_TRACKED_NEW(MEMORY_CATEGORY_ATLAS)
+
 	/// create an empty dynamic atlas (region can be updated and added)
 	/// @param textureSize an atlas creates a texture cube of 6 faces with size equal to (textureSize*textureSize * sizeof(RGBA) )
 	/// @param maxRegionCount maximum number of region allowed in the atlas
@@ -62,6 +122,14 @@ public:
 	/// retrieve the usage ratio of the atlas
 	//float getUsageRatio() const { return 0.0f; }
 
+	/// retrieve the packed texels of all faces in squared pixels
+	uint32_t getUsedSurface() const;
+
+	/// retrieve the bytes holding packed texels and region infos
+	uint32_t getUsedBytes() const {
+		return this->getUsedSurface() * (this->is_bgra ? 4 : 1) + this->region_num * sizeof(AtlasRegion);
+	}
+
 	/// retrieve the numbers of region in the atlas
 	uint16_t getRegionNum() const {
 		return this->region_num;
@@ -0,0 +1,212 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "EditSession.h"
+
+
+EditSession::EditSession(TextEngine* te, float line_height, int win_w, int win_h)
+	:te(te), lh(line_height), win_w(win_w), win_h(win_h) {}
+
+
+float EditSession::_ComputeTextHeight() {
+	float height = 0;
+	size_t paragraph_num = this->te->GetParagarphNum();
+	for (size_t i = 0;i < paragraph_num;++i) {
+		size_t line_num = this->te->GetParagraph(i)->lines.GetSize();
+		height += (line_num == 0 ? 1 : line_num) * this->lh;
+	}
+	return height;
+}
+
+
+void EditSession::_UpdateOffsetMax() {
+	this->text_height = this->_ComputeTextHeight();
+	float a_offset_old = this->offset * this->offset_max;
+	this->offset_max = this->text_height > this->win_h ? this->text_height - this->win_h : 0;
+	this->offset = a_offset_old / this->offset_max;
+	this->offset = this->offset > 0 ? (this->offset < 1 ? this->offset : 1) : 0;
+}
+
+
+void EditSession::_CheckCursor() {
+	if (this->cursor_y + this->lh / 2 - this->offset * this->offset_max < 0)
+		this->offset = this->cursor_y / this->offset_max;
+	else if (this->cursor_y + this->lh / 2 - this->offset * this->offset_max > this->win_h)
+		this->offset = (this->cursor_y - this->win_h + this->lh) / this->offset_max;
+	this->offset = this->offset > 0 ? (this->offset < 1 ? this->offset : 1) : 0;
+}
+
+
+void EditSession::_UpdateCursor(bool check_cursor_pos) {
+	this->cursor_x = 0;
+	this->cursor_y = 0;
+	this->te->ComputeCursorPos(this->ipos, this->lh, this->cursor_x, this->cursor_y);
+	if (check_cursor_pos)
+		this->_CheckCursor();
+}
+
+
+void EditSession::_Record(const EditEvent& e) {
+	if (this->recorder != nullptr)
+		this->recorder->Write(e);
+}
+
+
+void EditSession::Begin(const char* utf8_str, size_t len) {
+	this->te->Append(utf8_str, len);
+	this->text_height = this->_ComputeTextHeight();
+	this->offset_max = this->text_height > this->win_h ? this->text_height - this->win_h : 0;
+	this->_UpdateCursor(false);
+}
+
+
+bool EditSession::Apply(const EditEvent& e) {
+	switch (e.type) {
+	case EDIT_EVENT_TEXT_INPUT:
+		return this->TextInput(e.text, e.text_len);
+	case EDIT_EVENT_KEY:
+		return this->Key(e.key);
+	case EDIT_EVENT_MOUSE_DOWN:
+		return this->MouseDown(e.x, e.y);
+	case EDIT_EVENT_MOUSE_MOTION:
+		return this->MouseMotion(e.x, e.y);
+	case EDIT_EVENT_MOUSE_UP:
+		return this->MouseUp();
+	case EDIT_EVENT_MOUSE_WHEEL:
+		return this->MouseWheel(e.y);
+	case EDIT_EVENT_RESIZE:
+		return this->Resize(e.w, e.h);
+	}
+	return false;
+}
+
+
+bool EditSession::TextInput(const char* utf8_str, size_t len) {
+	EditEvent e;
+	e.type = EDIT_EVENT_TEXT_INPUT;
+	e.text = utf8_str;
+	e.text_len = len;
+	this->_Record(e);
+	if (this->ipos == this->spos)
+		this->ipos = this->te->Insert(utf8_str, len, this->ipos);
+	else
+		this->ipos = this->te->Replace(utf8_str, len, this->ipos, this->spos);
+	this->spos = this->ipos;
+	this->_UpdateOffsetMax();
+	this->_UpdateCursor(true);
+	return true;
+}
+
+
+bool EditSession::Key(int key) {
+	switch (key) {
+	case EDIT_KEY_UP:
+		this->ipos = this->te->CursorUp(this->ipos);
+		break;
+	case EDIT_KEY_DOWN:
+		this->ipos = this->te->CursorDown(this->ipos);
+		break;
+	case EDIT_KEY_LEFT:
+		this->ipos = this->te->CursorLeft(this->ipos);
+		break;
+	case EDIT_KEY_RIGHT:
+		this->ipos = this->te->CursorRight(this->ipos);
+		break;
+	case EDIT_KEY_BACKSPACE:
+		if (this->spos == this->ipos)
+			this->spos = this->te->PreCodepoint(this->ipos);
+		this->te->Delete(this->spos, this->ipos);
+		if (this->ipos > this->spos)
+			this->ipos = this->spos;
+		break;
+	case EDIT_KEY_RETURN:
+		this->ipos = this->te->Insert("\n", 1, this->ipos);
+		break;
+	default:
+		return false;
+	}
+	EditEvent e;
+	e.type = EDIT_EVENT_KEY;
+	e.key = key;
+	this->_Record(e);
+	this->spos = this->ipos;
+	this->_UpdateOffsetMax();
+	this->_UpdateCursor(true);
+	return true;
+}
+
+
+bool EditSession::MouseDown(float x, float y) {
+	EditEvent e;
+	e.type = EDIT_EVENT_MOUSE_DOWN;
+	e.x = x;
+	e.y = y;
+	this->_Record(e);
+	this->ipos = this->te->Hit(this->lh, x, y + this->offset * this->offset_max);
+	this->spos = this->ipos;
+	this->_UpdateCursor(false);
+	this->mouse_down = true;
+	this->m_x = x;
+	this->m_y = y;
+	return true;
+}
+
+
+bool EditSession::MouseMotion(float x, float y) {
+	//Hover motion does not touch the engine, keep it out of the trace
+	if (!this->mouse_down)
+		return false;
+	EditEvent e;
+	e.type = EDIT_EVENT_MOUSE_MOTION;
+	e.x = x;
+	e.y = y;
+	this->_Record(e);
+	this->ipos = this->te->Hit(this->lh, x, y + this->offset * this->offset_max);
+	this->_UpdateCursor(true);
+	this->m_x = x;
+	this->m_y = y;
+	return true;
+}
+
+
+bool EditSession::MouseUp() {
+	EditEvent e;
+	e.type = EDIT_EVENT_MOUSE_UP;
+	this->_Record(e);
+	this->mouse_down = false;
+	return false;
+}
+
+
+bool EditSession::MouseWheel(float y) {
+	EditEvent e;
+	e.type = EDIT_EVENT_MOUSE_WHEEL;
+	e.y = y;
+	this->_Record(e);
+	if (this->offset_max > 0)
+		this->offset += -y * 10 / this->offset_max;
+	if (this->offset < 0)
+		this->offset = 0;
+	else if (this->offset > 1)
+		this->offset = 1;
+	if (this->mouse_down)
+		this->ipos = this->te->Hit(this->lh, this->m_x, this->m_y + this->offset * this->offset_max);
+	this->_UpdateCursor(false);
+	return true;
+}
+
+
+bool EditSession::Resize(int w, int h) {
+	EditEvent e;
+	e.type = EDIT_EVENT_RESIZE;
+	e.w = w;
+	e.h = h;
+	this->_Record(e);
+	this->win_w = w;
+	this->win_h = h;
+	this->te->SetWarpWidth(w);
+	this->ipos = this->te->CheckCursorPos(this->ipos);
+	this->_UpdateOffsetMax();
+	this->_UpdateCursor(false);
+	return true;
+}
@@ -0,0 +1,79 @@
+#ifndef EDIT_SESSION_H
+#define EDIT_SESSION_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "TextEngine.h"
+#include "EditTrace.h"
+
+//Cursor, selection and scrolling of the demo, without any window. The demo
+//feeds it translated SDL events and the replayer feeds it a recorded trace,
+//so both drive TextEngine through the very same calls.
+class EditSession {
+	TextEngine* te;
+	float lh;
+	int win_w;
+	int win_h;
+
+	float text_height = 0;
+	float offset = 0;
+	float offset_max = 0;
+
+	CPPos spos;
+	CPPos ipos;
+
+	bool mouse_down = false;
+	float m_x = 0;
+	float m_y = 0;
+
+	float cursor_x = 0;
+	float cursor_y = 0;
+
+	EditTraceWriter* recorder = nullptr;
+
+	float _ComputeTextHeight();
+	void _UpdateOffsetMax();
+	void _CheckCursor();
+	void _UpdateCursor(bool check_cursor_pos);
+	void _Record(const EditEvent& e);
+
+public:
+	EditSession(TextEngine* te, float line_height, int win_w, int win_h);
+	void SetRecorder(EditTraceWriter* recorder) {
+		this->recorder = recorder;
+	}
+	//Loads the initial document, not recorded as an event
+	void Begin(const char* utf8_str, size_t len);
+
+	//Each returns whether the view has to be redrawn
+	bool Apply(const EditEvent& e);
+	bool TextInput(const char* utf8_str, size_t len);
+	bool Key(int key);
+	bool MouseDown(float x, float y);
+	bool MouseMotion(float x, float y);
+	bool MouseUp();
+	bool MouseWheel(float y);
+	bool Resize(int w, int h);
+
+	const CPPos& GetInsertPos() const {
+		return this->ipos;
+	}
+	const CPPos& GetSelectPos() const {
+		return this->spos;
+	}
+	float GetScroll() const {
+		return this->offset * this->offset_max;
+	}
+	float GetCursorX() const {
+		return this->cursor_x;
+	}
+	float GetCursorY() const {
+		return this->cursor_y;
+	}
+	float GetLineHeight() const {
+		return this->lh;
+	}
+};
+
+#endif
@@ -0,0 +1,246 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "EditTrace.h"
+#include <cstdlib>
+#include <cstring>
+#include "PipelineStats.h"
+
+#define EDIT_TRACE_MAGIC "TERT"
+#define EDIT_TRACE_VERSION 1
+
+
+const char* edit_event_names[EDIT_EVENT_NUM] = {
+	"text_input",
+	"key",
+	"mouse_down",
+	"mouse_motion",
+	"mouse_up",
+	"mouse_wheel",
+	"resize",
+};
+
+
+const char* EditEventName(int type) {
+	if (type < 0 || type >= EDIT_EVENT_NUM)
+		return "unknown";
+	return edit_event_names[type];
+}
+
+
+void EditTraceWriter::_WriteVarint(uint64_t value) {
+	uint8_t buffer[10];
+	size_t len = 0;
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+		buffer[len++] = byte;
+	} while (value != 0);
+	fwrite(buffer, 1, len, this->fp);
+}
+
+
+void EditTraceWriter::_WriteFloat(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint8_t buffer[4] = {
+		static_cast<uint8_t>(bits),
+		static_cast<uint8_t>(bits >> 8),
+		static_cast<uint8_t>(bits >> 16),
+		static_cast<uint8_t>(bits >> 24)
+	};
+	fwrite(buffer, 1, 4, this->fp);
+}
+
+
+bool EditTraceWriter::Open(const char* path, uint32_t font_height, float line_height, int win_w, int win_h, const char* text, size_t len) {
+	this->Close();
+	this->fp = fopen(path, "wb");
+	if (!this->fp)
+		return false;
+	fwrite(EDIT_TRACE_MAGIC, 1, 4, this->fp);
+	this->_WriteVarint(EDIT_TRACE_VERSION);
+	this->_WriteVarint(font_height);
+	this->_WriteFloat(line_height);
+	this->_WriteVarint(win_w < 0 ? 0 : win_w);
+	this->_WriteVarint(win_h < 0 ? 0 : win_h);
+	this->_WriteVarint(len);
+	fwrite(text, 1, len, this->fp);
+	this->start = PipelineStatsNow() / 1000;
+	this->last = 0;
+	return true;
+}
+
+
+void EditTraceWriter::Write(const EditEvent& e) {
+	if (!this->fp)
+		return;
+	uint64_t now = PipelineStatsNow() / 1000 - this->start;
+	if (now < this->last)
+		now = this->last;
+	fputc(e.type, this->fp);
+	this->_WriteVarint(now - this->last);
+	this->last = now;
+	switch (e.type) {
+	case EDIT_EVENT_TEXT_INPUT:
+		this->_WriteVarint(e.text_len);
+		fwrite(e.text, 1, e.text_len, this->fp);
+		break;
+	case EDIT_EVENT_KEY:
+		fputc(e.key, this->fp);
+		break;
+	case EDIT_EVENT_MOUSE_DOWN:
+	case EDIT_EVENT_MOUSE_MOTION:
+	case EDIT_EVENT_MOUSE_WHEEL:
+		this->_WriteFloat(e.x);
+		this->_WriteFloat(e.y);
+		break;
+	case EDIT_EVENT_RESIZE:
+		this->_WriteVarint(e.w < 0 ? 0 : e.w);
+		this->_WriteVarint(e.h < 0 ? 0 : e.h);
+		break;
+	}
+}
+
+
+void EditTraceWriter::Close() {
+	if (!this->fp)
+		return;
+	fclose(this->fp);
+	this->fp = nullptr;
+}
+
+
+bool EditTraceReader::_ReadVarint(uint64_t& value) {
+	value = 0;
+	for (int shift = 0;shift < 64;shift += 7) {
+		if (this->pos >= this->size)
+			return false;
+		uint8_t byte = this->buffer[this->pos++];
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+bool EditTraceReader::_ReadFloat(float& value) {
+	if (this->size - this->pos < 4)
+		return false;
+	const uint8_t* p = this->buffer + this->pos;
+	uint32_t bits = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	memcpy(&value, &bits, sizeof(value));
+	this->pos += 4;
+	return true;
+}
+
+
+bool EditTraceReader::Open(const char* path) {
+	this->Close();
+	FILE* fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size < 4) {
+		fclose(fp);
+		return false;
+	}
+	this->buffer = reinterpret_cast<uint8_t*>(malloc(size));
+	this->size = fread(this->buffer, 1, size, fp);
+	fclose(fp);
+
+	uint64_t version, font_height, win_w, win_h, text_len;
+	if (memcmp(this->buffer, EDIT_TRACE_MAGIC, 4) != 0)
+		goto FAILED;
+	this->pos = 4;
+	if (!this->_ReadVarint(version) || version != EDIT_TRACE_VERSION)
+		goto FAILED;
+	if (!this->_ReadVarint(font_height) || !this->_ReadFloat(this->line_height))
+		goto FAILED;
+	if (!this->_ReadVarint(win_w) || !this->_ReadVarint(win_h))
+		goto FAILED;
+	if (!this->_ReadVarint(text_len) || text_len > this->size - this->pos)
+		goto FAILED;
+	this->font_height = static_cast<uint32_t>(font_height);
+	this->win_w = static_cast<int>(win_w);
+	this->win_h = static_cast<int>(win_h);
+	this->text = reinterpret_cast<const char*>(this->buffer + this->pos);
+	this->text_len = text_len;
+	this->pos += text_len;
+	this->Rewind();
+	return true;
+
+FAILED:
+	this->Close();
+	return false;
+}
+
+
+void EditTraceReader::Rewind() {
+	if (this->buffer == nullptr)
+		return;
+	this->pos = reinterpret_cast<const uint8_t*>(this->text) - this->buffer + this->text_len;
+	this->time = 0;
+}
+
+
+bool EditTraceReader::Next(EditEvent& e) {
+	if (this->pos >= this->size)
+		return false;
+	e = EditEvent();
+	e.type = this->buffer[this->pos++];
+	uint64_t delta, a, b;
+	if (!this->_ReadVarint(delta))
+		return false;
+	this->time += delta;
+	e.time_us = this->time;
+	switch (e.type) {
+	case EDIT_EVENT_TEXT_INPUT:
+		if (!this->_ReadVarint(a) || a > this->size - this->pos)
+			return false;
+		e.text = reinterpret_cast<const char*>(this->buffer + this->pos);
+		e.text_len = a;
+		this->pos += a;
+		break;
+	case EDIT_EVENT_KEY:
+		if (this->pos >= this->size)
+			return false;
+		e.key = this->buffer[this->pos++];
+		break;
+	case EDIT_EVENT_MOUSE_DOWN:
+	case EDIT_EVENT_MOUSE_MOTION:
+	case EDIT_EVENT_MOUSE_WHEEL:
+		if (!this->_ReadFloat(e.x) || !this->_ReadFloat(e.y))
+			return false;
+		break;
+	case EDIT_EVENT_MOUSE_UP:
+		break;
+	case EDIT_EVENT_RESIZE:
+		if (!this->_ReadVarint(a) || !this->_ReadVarint(b))
+			return false;
+		e.w = static_cast<int>(a);
+		e.h = static_cast<int>(b);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+
+void EditTraceReader::Close() {
+	free(this->buffer);
+	this->buffer = nullptr;
+	this->size = 0;
+	this->pos = 0;
+	this->time = 0;
+	this->text = nullptr;
+	this->text_len = 0;
+	this->font_height = 0;
+	this->line_height = 0;
+}
@@ -0,0 +1,112 @@
+#ifndef EDIT_TRACE_H
+#define EDIT_TRACE_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#define EDIT_EVENT_TEXT_INPUT	0
+#define EDIT_EVENT_KEY		1
+#define EDIT_EVENT_MOUSE_DOWN	2
+#define EDIT_EVENT_MOUSE_MOTION	3
+#define EDIT_EVENT_MOUSE_UP	4
+#define EDIT_EVENT_MOUSE_WHEEL	5
+#define EDIT_EVENT_RESIZE	6
+#define EDIT_EVENT_NUM		7
+
+#define EDIT_KEY_UP		0
+#define EDIT_KEY_DOWN		1
+#define EDIT_KEY_LEFT		2
+#define EDIT_KEY_RIGHT		3
+#define EDIT_KEY_BACKSPACE	4
+#define EDIT_KEY_RETURN		5
+
+struct EditEvent {
+	uint8_t type = EDIT_EVENT_TEXT_INPUT;
+	uint64_t time_us = 0;		//Since the start of the recording
+	int key = 0;			//EDIT_EVENT_KEY
+	float x = 0;			//Mouse position, or wheel delta in y
+	float y = 0;
+	int w = 0;			//EDIT_EVENT_RESIZE, in pixels
+	int h = 0;
+	const char* text = nullptr;	//EDIT_EVENT_TEXT_INPUT, UTF-8, not terminated
+	size_t text_len = 0;
+};
+
+const char* EditEventName(int type);
+
+
+//File layout: "TERT", version, font height, line height, window size,
+//initial text, then
+//one record per event: type byte, varint time delta in us, payload
+//(varint length + UTF-8 / key byte / two float32 / varint w,h).
+class EditTraceWriter {
+	FILE* fp = nullptr;
+	uint64_t start = 0;
+	uint64_t last = 0;
+
+	void _WriteVarint(uint64_t value);
+	void _WriteFloat(float value);
+
+public:
+	bool Open(const char* path, uint32_t font_height, float line_height, int win_w, int win_h, const char* text, size_t len);
+	void Write(const EditEvent& e);
+	void Close();
+	~EditTraceWriter() {
+		this->Close();
+	}
+};
+
+
+class EditTraceReader {
+	uint8_t* buffer = nullptr;
+	size_t size = 0;
+	size_t pos = 0;
+	uint64_t time = 0;
+
+	uint32_t font_height = 0;
+	float line_height = 0;
+	int win_w = 0;
+	int win_h = 0;
+	const char* text = nullptr;
+	size_t text_len = 0;
+
+	bool _ReadVarint(uint64_t& value);
+	bool _ReadFloat(float& value);
+
+public:
+	bool Open(const char* path);
+	//Returns false at the end of the trace or on a malformed record
+	bool Next(EditEvent& e);
+	void Rewind();
+	bool IsAtEnd() const {
+		return this->pos >= this->size;
+	}
+	uint32_t GetFontHeight() const {
+		return this->font_height;
+	}
+	float GetLineHeight() const {
+		return this->line_height;
+	}
+	int GetWindowWidth() const {
+		return this->win_w;
+	}
+	int GetWindowHeight() const {
+		return this->win_h;
+	}
+	const char* GetInitialText() const {
+		return this->text;
+	}
+	size_t GetInitialTextLength() const {
+		return this->text_len;
+	}
+	void Close();
+	~EditTraceReader() {
+		this->Close();
+	}
+};
+
+#endif
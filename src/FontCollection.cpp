@@ -3,6 +3,8 @@
 
 #include "FontCollection.h"
 #include <hb-ft.h>
+#include "PipelineStats.h"
+#include "TraceRecorder.h"
 
 float FT_Fix26ToFloat(FT_Pos val) {
 	long i = val >> 6;
@@ -76,14 +78,20 @@ void FontCollection::_AppendFont(Font* font) {
 
 
 bool FontCollection::_AtlasAdd(uint8_t* buffer, int w, int h, bool is_bgra, GlyphInfo& info) {
+	STATS_STAGE(PIPELINE_STAGE_ATLAS_PACK);
 	Array<Atlas*>* atlases;
 	if (is_bgra)
 		atlases = &this->atlases_bgra;
-	else 
+	else
 		atlases = &this->atlases_gray;
 
+	//Wider than a face once the border and margin are added, a new page would be thrown away
+	int atlas_size = is_bgra ? ATLAS_SIZE_RGBA : ATLAS_SIZE_GRAY;
+	if (w + 4 > atlas_size || h + 4 > atlas_size)
+		return false;
+
 	if (atlases->GetSize() == 0)
-		this->_NewAtlas(info.pixel_type == GLYPH_PIXEL_TYPE_BGRA);
+		this->_NewAtlas(is_bgra);
 	int i = 0;
 	info.region_index = UINT16_MAX;
 	while (info.region_index >= 4096 && i < atlases->GetSize()) {
@@ -92,7 +100,7 @@ bool FontCollection::_AtlasAdd(uint8_t* buffer, int w, int h, bool is_bgra, Glyp
 		++i;
 	}
 	if (info.region_index >= 4096) {
-		this->_NewAtlas(info.pixel_type == GLYPH_PIXEL_TYPE_BGRA);
+		this->_NewAtlas(is_bgra);
 		info.region_index = atlases->Get(atlases->GetSize() - 1)->addRegion(w, h, buffer, 1);
 		if (info.region_index >= 4096) {
 			Atlas* temp = atlases->Get(atlases->GetSize() - 1);
@@ -106,11 +114,13 @@ bool FontCollection::_AtlasAdd(uint8_t* buffer, int w, int h, bool is_bgra, Glyp
 	if (info.region_index >= 4096)
 		return false;
 
+	STATS_COUNT(atlas_insertions, 1);
 	return true;
 }
 
 
 void FontCollection::_AddDummyGlyph() {
+	this->dummy_info.pixel_type = GLYPH_PIXEL_TYPE_GRAY;
 	uint32_t dummy_size = this->pixel_height * 0.5;
 	uint8_t* dummy_bitmap = new uint8_t[dummy_size * dummy_size];
 	for (int j = 0;j < dummy_size;++j)
@@ -121,10 +131,14 @@ void FontCollection::_AddDummyGlyph() {
 	this->dummy_info.advance_x = this->GetMaxAdvance();
 	this->dummy_info.advance_y = this->GetMaxAdvance();
 	this->_AtlasAdd(dummy_bitmap, dummy_size, dummy_size, false, this->dummy_info); 
+	delete[] dummy_bitmap;
 }
 
 
-FontCollection::FontCollection(FT_Library ft_lib, uint32_t pixel_height, bool use_sdf) {
+FontCollection::FontCollection(FT_Library ft_lib, uint32_t pixel_height, bool use_sdf) :
+	atlases_gray(128, MEMORY_HOOKS(MEMORY_CATEGORY_ATLAS)),
+	atlases_bgra(128, MEMORY_HOOKS(MEMORY_CATEGORY_ATLAS)) {
+	MEMORY_SCOPE(&this->memory);
 	this->ft_lib = ft_lib;
 	this->SetHeightInPixel(pixel_height);
 	this->use_sdf = use_sdf;
@@ -134,6 +148,7 @@ FontCollection::FontCollection(FT_Library ft_lib, uint32_t pixel_height, bool us
 void FontCollection::SetHeightInPixel(uint32_t pixel_height) {
 	if (this->pixel_height == pixel_height)
 		return;
+	MEMORY_SCOPE(&this->memory);
 	this->pixel_height = pixel_height;
 	Font* p = this->head;
 	while (p != nullptr) {
@@ -147,6 +162,7 @@ void FontCollection::SetHeightInPixel(uint32_t pixel_height) {
 
 
 Font* FontCollection::AddFont(uint8_t* buffer, size_t size) {
+	MEMORY_SCOPE(&this->memory);
 	FT_Face face;
 	Font* font = nullptr;
 	if(FT_New_Memory_Face(this->ft_lib, buffer, size, 0, &face))
@@ -173,6 +189,7 @@ ft_create_fail:
 
 
 void FontCollection::FontMoveForward(Font* font) {
+	MEMORY_SCOPE(&this->memory);
 	if (font->pre == nullptr)
 		return;
 	if (font->next == nullptr)
@@ -194,6 +211,7 @@ void FontCollection::FontMoveForward(Font* font) {
 
 
 void FontCollection::FontMoveBackward(Font* font) {
+	MEMORY_SCOPE(&this->memory);
 	if (font->next = nullptr)
 		return;
 	if (font->pre = nullptr)
@@ -215,6 +233,7 @@ void FontCollection::FontMoveBackward(Font* font) {
 
 
 void FontCollection::RemoveFont(Font* font) {
+	MEMORY_SCOPE(&this->memory);
 	if (font->pre != nullptr)
 		font->pre->next = font->next;
 	else
@@ -233,6 +252,7 @@ void FontCollection::RemoveFont(Font* font) {
 
 
 void FontCollection::ClearFonts() {
+	MEMORY_SCOPE(&this->memory);
 	Font* p = this->head;
 	while (p != nullptr) {
 		Font* temp = p;
@@ -255,15 +275,22 @@ bool FontCollection::GetGlyph(FT_UInt glyph_index, Font* font, GlyphInfo& glyph_
 		return false;
 	auto cached = font->glyph_cache.Find(glyph_index);
 	if (!cached.IsNull()) {
+		STATS_COUNT(glyph_cache_hits, 1);
 		glyph_info = cached.Value();
 		return true;
 	}
+	STATS_COUNT(glyph_cache_misses, 1);
+	MEMORY_SCOPE(&this->memory);
 
-	if (FT_Load_Glyph(font->face, glyph_index, 0))
-		return false;
+	{
+		STATS_STAGE(PIPELINE_STAGE_RASTERIZE);
+		if (FT_Load_Glyph(font->face, glyph_index, 0))
+			return false;
 
-	if (FT_Render_Glyph(font->face->glyph, this->use_sdf ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL))
-		return false;
+		TRACE_SPAN("FT_Render_Glyph");
+		if (FT_Render_Glyph(font->face->glyph, this->use_sdf ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL))
+			return false;
+	}
 
 	FT_GlyphSlot glyph = font->face->glyph;
 	glyph_info.offset_x = glyph->bitmap_left;
@@ -299,6 +326,23 @@ bool FontCollection::GetDummyGlyph(GlyphInfo& glyph_info) {
 }
 
 
+MemoryStats FontCollection::GetMemoryStats() {
+	MemoryStats ret;
+	this->memory.Fill(ret);
+	Font* p = this->head;
+	while (p != nullptr) {
+		ret.categories[MEMORY_CATEGORY_FONTS].used += sizeof(Font);
+		ret.categories[MEMORY_CATEGORY_GLYPH_CACHE].used += p->glyph_cache.GetSize() * (sizeof(FT_UInt) + sizeof(GlyphInfo));
+		p = p->next;
+	}
+	for (size_t i = 0;i < this->atlases_gray.GetSize();++i)
+		ret.categories[MEMORY_CATEGORY_ATLAS].used += sizeof(Atlas*) + this->atlases_gray.Get(i)->getUsedBytes();
+	for (size_t i = 0;i < this->atlases_bgra.GetSize();++i)
+		ret.categories[MEMORY_CATEGORY_ATLAS].used += sizeof(Atlas*) + this->atlases_bgra.Get(i)->getUsedBytes();
+	return ret;
+}
+
+
 const uint8_t* FontCollection::GetAtlasBuffer(const GlyphInfo& glyph_info, int face_index) {
 	if (glyph_info.pixel_type == GLYPH_PIXEL_TYPE_BGRA)
 		return this->atlases_bgra.Get(glyph_info.atlas_index)->getAtlasBuffer() + ATLAS_SIZE_RGBA * ATLAS_SIZE_RGBA * face_index;
@@ -315,6 +359,16 @@ const AtlasRegion& FontCollection::GetAtlasRegion(const GlyphInfo& glyph_info) {
 }
 
 
+hb_buffer_t* FontCollection::GetShapeBuffer() {
+	if (this->shape_buffer == nullptr)
+		this->shape_buffer = hb_buffer_create();
+	else
+		hb_buffer_clear_contents(this->shape_buffer);
+	return this->shape_buffer;
+}
+
+
 FontCollection::~FontCollection() {
 	this->ClearFonts();
+	hb_buffer_destroy(this->shape_buffer);
 }
\ No newline at end of file
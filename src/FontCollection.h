@@ -11,6 +11,7 @@
 #include "Array.h"
 #include "Map.h"
 #include "CubeAtlas.h"
+#include "MemoryStats.h"
 
 #define GLYPH_PIXEL_TYPE_GRAY	0
 #define GLYPH_PIXEL_TYPE_BGRA	1
@@ -18,6 +19,8 @@
 
 #define ATLAS_SIZE_GRAY	512
 #define ATLAS_SIZE_RGBA 256
+//Glyphs a font's cache makes room for on its first glyph, a script's worth
+#define GLYPH_CACHE_INITIAL_SIZE 128
 
 struct GlyphInfo {
 	float offset_x;
@@ -43,6 +46,9 @@ class Font {
 
 	Map<FT_UInt, GlyphInfo> glyph_cache;
 
+	MEMORY_TRACKED_NEW(MEMORY_CATEGORY_FONTS)
+	Font() :glyph_cache(MEMORY_HOOKS(MEMORY_CATEGORY_GLYPH_CACHE), GLYPH_CACHE_INITIAL_SIZE) {}
+
 public:
 	Font* Next() {
 		return this->next;
@@ -63,6 +69,7 @@ public:
 
 
 class FontCollection {
+	MemoryAccount memory;
 	FT_Library ft_lib;
 	uint32_t pixel_height = 0;
 	bool use_sdf;
@@ -79,6 +86,7 @@ class FontCollection {
 	Array<Atlas*> atlases_bgra;
 
 	GlyphInfo dummy_info;
+	hb_buffer_t* shape_buffer = nullptr;
 
 	bool max_dirty = true;
 	void _UpdateMaxMetrics();
@@ -122,8 +130,18 @@ public:
 	}
 	bool GetGlyph(FT_UInt glyph_index , Font* font, GlyphInfo& glyph_info);
 	bool GetDummyGlyph(GlyphInfo& glyph_info);
+	//Empty buffer shared by every shaping call, it keeps its storage between them
+	hb_buffer_t* GetShapeBuffer();
+	//Bytes allocated for fonts, glyph caches and atlases
+	MemoryStats GetMemoryStats();
 	const uint8_t* GetAtlasBuffer(const GlyphInfo& glyph_info, int face_index);
 	const AtlasRegion& GetAtlasRegion(const GlyphInfo& glyph_info);
+	size_t GetAtlasNum(bool is_bgra) {
+		return is_bgra ? this->atlases_bgra.GetSize() : this->atlases_gray.GetSize();
+	}
+	const Atlas* GetAtlas(bool is_bgra, size_t index) {
+		return is_bgra ? this->atlases_bgra.Get(index) : this->atlases_gray.Get(index);
+	}
 	static size_t GetAtlasSize(const GlyphInfo& glyph_info) {
 		return glyph_info.pixel_type == GLYPH_PIXEL_TYPE_BGRA ? ATLAS_SIZE_RGBA : ATLAS_SIZE_GRAY;
 	}
@@ -0,0 +1,37 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "MemoryStats.h"
+#include <cstdint>
+#include <cstring>
+
+
+//HarfBuzz is built with these as its allocator, see CMakeLists.txt. Its faces
+//and shape plans are shared between engines and outlive edits, so they are
+//charged to global_memory_account rather than the current one.
+extern "C" void* hb_malloc_impl(size_t size) {
+	MemoryAccountScope scope(&global_memory_account);
+	return MemoryAlloc(MEMORY_CATEGORY_SHAPING, size);
+}
+
+
+extern "C" void* hb_calloc_impl(size_t num, size_t size) {
+	if (size != 0 && num > SIZE_MAX / size)
+		return nullptr;
+	void* ret = hb_malloc_impl(num * size);
+	if (ret != nullptr)
+		memset(ret, 0, num * size);
+	return ret;
+}
+
+
+extern "C" void* hb_realloc_impl(void* mem, size_t size) {
+	if (mem == nullptr)
+		return hb_malloc_impl(size);
+	return MemoryRealloc(mem, size);
+}
+
+
+extern "C" void hb_free_impl(void* mem) {
+	MemoryRelease(mem);
+}
@@ -14,6 +14,7 @@ class List {
 private:
 	Copy<T> copy;
 	Deconstructor<T> deconstruct;
+	Initializer<T> initialize;
 
 	struct Node {
 		ContainerNode<T> data;
@@ -21,17 +22,8 @@ private:
 		Node* next = nullptr;
 
 		Node() {}
-
-		Node& operator==(const Node& right) {
-			copy(this->data, right.data);
-			this->pre = right.pre;
-			this->next = right.next;
-			return this;
-		}
-
-		Node(const Node& obj) {
-			this->operator==(obj);
-		}
+		Node(const Node&) = delete;
+		Node& operator=(const Node&) = delete;
 	};
 
 	class NullListNodeRef :std::runtime_error {
@@ -98,7 +90,8 @@ private:
 		if (IS_NULL_POINTER(this->malloc_f))
 			ret = reinterpret_cast<Node*>(malloc(sizeof(Node)));
 		else
-			Node* ret = reinterpret_cast<Node*>(this->malloc_f(sizeof(Node)));
+			ret = reinterpret_cast<Node*>(this->malloc_f(sizeof(Node)));
+		this->initialize(&ret->data, 1);
 		ret->next = nullptr;
 		ret->pre = nullptr;
 		return ret;
@@ -112,12 +105,81 @@ private:
 			return this->free_f(node);
 	}
 
+	void _LinkFront(Node* temp) {
+		if (IS_NULL_POINTER(this->head))
+			this->tail = temp;
+		else {
+			temp->next = this->head;
+			this->head->pre = temp;
+		}
+		this->head = temp;
+		++this->size;
+	}
+
+	void _LinkBack(Node* temp) {
+		if (IS_NULL_POINTER(this->tail))
+			this->head = temp;
+		else {
+			temp->pre = this->tail;
+			this->tail->next = temp;
+		}
+		this->tail = temp;
+		++this->size;
+	}
+
+	void _LinkBefore(Node* node, Node* temp) {
+		temp->next = node;
+		temp->pre = node->pre;
+		if (IS_NULL_POINTER(node->pre))
+			this->head = temp;
+		else
+			node->pre->next = temp;
+		node->pre = temp;
+		++this->size;
+	}
+
+	void _LinkAfter(Node* node, Node* temp) {
+		temp->next = node->next;
+		temp->pre = node;
+		if (IS_NULL_POINTER(node->next))
+			this->tail = temp;
+		else
+			node->next->pre = temp;
+		node->next = temp;
+		++this->size;
+	}
+
 public:
 	List(MAllocF* malloc_f = nullptr, FreeF* free_f = nullptr):malloc_f(malloc_f),free_f(free_f) {}
 
+	List(const List<T>&) = delete;
+	List<T>& operator=(const List<T>&) = delete;
+
+	//Takes the nodes of other, which is left empty
+	List(List<T>&& other):size(other.size), malloc_f(other.malloc_f), free_f(other.free_f), head(other.head), tail(other.tail) {
+		other.head = nullptr;
+		other.tail = nullptr;
+		other.size = 0;
+	}
+
+	List<T>& operator=(List<T>&& other) {
+		if (this == &other)
+			return *this;
+		this->Clear();
+		this->size = other.size;
+		this->malloc_f = other.malloc_f;
+		this->free_f = other.free_f;
+		this->head = other.head;
+		this->tail = other.tail;
+		other.head = nullptr;
+		other.tail = nullptr;
+		other.size = 0;
+		return *this;
+	}
+
 	void Clear() {
 		Node* p = head;
-		if (!IS_NULL_POINTER(head)) {
+		while (!IS_NULL_POINTER(p)) {
 			Node* temp = p;
 			p = p->next;
 			this->_DeleteNode(temp);
@@ -172,58 +234,71 @@ public:
 	void PushFront(const T& data) {
 		Node* temp = this->_NewNode();
 		this->copy(temp->data, data);
-		temp->data = data;
-		if (IS_NULL_POINTER(this->head))
-			this->tail = temp;
-		else {
-			temp->next = this->head;
-			this->head->pre = temp;
-		}
-		this->head = temp;
-		++this->size;
+		this->_LinkFront(temp);
+	}
+
+	void PushFront(T&& data) {
+		Node* temp = this->_NewNode();
+		this->copy(temp->data, std::move(data));
+		this->_LinkFront(temp);
 	}
 
 	void PushBack(const T& data) {
 		Node* temp = this->_NewNode();
 		this->copy(temp->data, data);
-		if (IS_NULL_POINTER(this->tail))
-			this->head = temp;
-		else {
-			temp->pre = this->tail;
-			this->tail->next = temp;
-		}
-		this->tail = temp;
-		++this->size;
+		this->_LinkBack(temp);
+	}
+
+	void PushBack(T&& data) {
+		Node* temp = this->_NewNode();
+		this->copy(temp->data, std::move(data));
+		this->_LinkBack(temp);
+	}
+
+	//Constructs the new last element from args in place
+	template<typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		Node* temp = this->_NewNode();
+		this->copy.Emplace(temp->data, std::forward<Args>(args)...);
+		this->_LinkBack(temp);
+		return temp->data._node.data;
 	}
 
 	void InsertBefore(const NodeRef& node, const T& value) {
 		Node* temp = this->_NewNode();
 		this->copy(temp->data, value);
-		temp->next = node.node;
-		temp->pre = node.node->pre;
-		if (IS_NULL_POINTER(node.node->pre))
-			this->head = temp;
-		else
-			node.node->pre->next = temp;
-		node.node->pre = temp;
-		++this->size;
+		this->_LinkBefore(node.node, temp);
+	}
+
+	void InsertBefore(const NodeRef& node, T&& value) {
+		Node* temp = this->_NewNode();
+		this->copy(temp->data, std::move(value));
+		this->_LinkBefore(node.node, temp);
 	}
 
 	void InsertAfter(const NodeRef& node, const T& value) {
 		Node* temp = this->_NewNode();
 		this->copy(temp->data, value);
-		temp->next = node.node->next;
-		temp->pre = node.node;
-		if (IS_NULL_POINTER(node.node->next))
-			this->tail = temp;
-		else
-			node.node->next->pre = temp;
-		node.node->next = temp;
-		++this->size;
+		this->_LinkAfter(node.node, temp);
+	}
+
+	void InsertAfter(const NodeRef& node, T&& value) {
+		Node* temp = this->_NewNode();
+		this->copy(temp->data, std::move(value));
+		this->_LinkAfter(node.node, temp);
+	}
+
+	//Constructs a new element after node from args in place
+	template<typename... Args>
+	T& EmplaceAfter(const NodeRef& node, Args&&... args) {
+		Node* temp = this->_NewNode();
+		this->copy.Emplace(temp->data, std::forward<Args>(args)...);
+		this->_LinkAfter(node.node, temp);
+		return temp->data._node.data;
 	}
 
 	void Remove(NodeRef& node) {
-		if (IS_NULL_POINTER(node))
+		if (IS_NULL_POINTER(node.node))
 			return;
 		if (IS_NULL_POINTER(node.node->pre))
 			this->head = node.node->next;
@@ -14,44 +14,41 @@ uint32_t HashFloat(double f) {
 
 
 uint32_t HashF<uint16_t>::operator()(const uint16_t& value) {
-	return value;
+	return HashMix32(value);
 }
 
 
 uint32_t HashF<uint32_t>::operator()(const uint32_t& value) {
-	return value;
+	return HashMix32(value);
 }
 
 
 uint32_t HashF<uint64_t>::operator()(const uint64_t& value) {
-	uint32_t ret = value & 0xFFFFFFFF;
-	ret += value << 32;
-	return ret;
+	return HashMix32(static_cast<uint32_t>(value ^ (value >> 32)));
 }
 
 
 uint32_t HashF<int16_t>::operator()(const int16_t& value) {
-	return static_cast<uint32_t>(value);
+	return HashMix32(static_cast<uint32_t>(value));
 }
 
 
 uint32_t HashF<int32_t>::operator()(const int32_t& value) {
-	return static_cast<uint32_t>(value);
+	return HashMix32(static_cast<uint32_t>(value));
 }
 
 
 uint32_t HashF<int64_t>::operator()(const int64_t& value) {
-	uint32_t ret = static_cast<uint64_t>(value) & 0xFFFFFFFF;
-	ret += static_cast<uint64_t>(value) << 32;
-	return ret;
+	uint64_t v = static_cast<uint64_t>(value);
+	return HashMix32(static_cast<uint32_t>(v ^ (v >> 32)));
 }
 
 
 uint32_t HashF<float>::operator()(const float& value) {
-	return HashFloat(static_cast<double>(value));
+	return HashMix32(HashFloat(static_cast<double>(value)));
 }
 
 
 uint32_t HashF<double>::operator()(const double& value) {
-	return HashFloat(value);
+	return HashMix32(HashFloat(value));
 }
\ No newline at end of file
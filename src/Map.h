@@ -9,6 +9,8 @@
 #include <cstdint>
 #include <climits>
 #include <cmath>
+#include <cstring>
+#include <utility>
 #include "MAllocUtils.h"
 #include "ContainerUtils.h"
 
@@ -77,15 +79,64 @@ public:
 };
 
 
-#define MAP_NODE(i) this->table[i]
-#define MAP_NODE_FLAGS(i) MAP_NODE(i).flags
-#define MAP_NODE_EMPTY(i) ((MAP_NODE_FLAGS(i)&0x1U)==0)
-#define MAP_NODE_HAS_NEXT(i) ((MAP_NODE_FLAGS(i)&0x2U)!=0)
-#define MAP_NODE_SET_EMPTY(i) MAP_NODE_FLAGS(i)&=(~0x1U)
-#define MAP_NODE_SET_USED(i) MAP_NODE_FLAGS(i)|=0x1U
-#define MAP_NODE_SET_HAS_NEXT(i) MAP_NODE_FLAGS(i)|=0x2U
-#define MAP_NODE_SET_NO_NEXT(i) MAP_NODE_FLAGS(i)&=(~0x2U)
-#define HASH_MOD(h,s)	(h % ((s-1)|1))
+//Every slot has a control byte. Slots are probed a group of MAP_GROUP_WIDTH
+//at a time, comparing the 7 bit tag of the hash against all control bytes
+//of the group at once.
+#define MAP_GROUP_WIDTH		8
+#define MAP_CTRL_EMPTY		0x80U
+#define MAP_CTRL_DELETED	0xFEU
+#define MAP_LSBS			0x0101010101010101ULL
+#define MAP_MSBS			0x8080808080808080ULL
+//At most 7 of 8 slots are used before the table grows
+#define MAP_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+//Murmur3 finalizer, spreads every input bit over the whole hash
+inline uint32_t HashMix32(uint32_t h) {
+	h ^= h >> 16;
+	h *= 0x85EBCA6BU;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35U;
+	h ^= h >> 16;
+	return h;
+}
+
+//Control bytes of a group, byte i in bits 8i to 8i+7
+inline uint64_t MapLoadGroup(const uint8_t* ctrl) {
+	uint64_t ret;
+	memcpy(&ret, ctrl, sizeof(ret));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	ret = __builtin_bswap64(ret);
+#endif
+	return ret;
+}
+
+//Index of the lowest byte flagged in a MAP_MSBS mask, mask must not be 0
+inline size_t MapLowestByte(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+#else
+	size_t ret = 0;
+	while ((mask & 0x80U) == 0) {
+		mask >>= 8;
+		++ret;
+	}
+	return ret;
+#endif
+}
+
+//Bytes equal to tag, may flag a byte next to a real match, keys are compared anyway
+inline uint64_t MapMatchTag(uint64_t group, uint8_t tag) {
+	uint64_t x = group ^ (MAP_LSBS * tag);
+	return (x - MAP_LSBS) & ~x & MAP_MSBS;
+}
+
+inline uint64_t MapMatchEmpty(uint64_t group) {
+	return group & ~(group << 6) & MAP_MSBS;
+}
+
+inline uint64_t MapMatchEmptyOrDeleted(uint64_t group) {
+	return group & MAP_MSBS;
+}
 
 template<typename Tk,typename Tv>
 class Map {
@@ -93,151 +144,159 @@ class Map {
 	Deconstructor<Tk> kdeconstruct;
 	Copy<Tv> vcopy;
 	Deconstructor<Tv> vdeconstruct;
+	Initializer<Tk> kinitialize;
+	Initializer<Tv> vinitialize;
 
-	struct Node {
-		uint8_t flags = 0;
-		size_t next = 0;
+	struct Slot {
 		ContainerNode<Tk> k;
-		uint32_t hk;
 		ContainerNode<Tv> v;
-
-		Node(){}
-
-		Node& operator==(const Node& right) {
-			this->flags = right.flags;
-			this->next = right.next;
-			kcopy(this->k, right.k);
-			this->hk = right.hk;
-			vcopy(this->v, right.v);
-			return this;
-		}
-
-		Node(const Node& obj) {
-			this->operator==(obj);
-		}
 	};
 
 	HashF<Tk> hash_f;
-	Node* table = nullptr;
-	size_t size;
-	size_t last_empty;
+	//Slots followed by their control bytes, one allocation
+	Slot* slots = nullptr;
+	uint8_t* ctrl = nullptr;
+	//Power of two multiple of MAP_GROUP_WIDTH, 0 until the first Set
+	size_t capacity = 0;
 	size_t num = 0;
+	//Empty slots that can still be used before the next rehash
+	size_t growth_left = 0;
+	size_t initial_capacity;
 
 	MAllocF* malloc_f = nullptr;
 	FreeF* free_f = nullptr;
 
-	Node* _NewTable(size_t len) {
-		Node* ret;
+	static size_t _CapacityFor(size_t n) {
+		size_t ret = MAP_GROUP_WIDTH;
+		while (MAP_MAX_LOAD(ret) < n)
+			ret *= 2;
+		return ret;
+	}
+
+	void _NewTable(size_t capacity) {
+		size_t bytes = capacity * sizeof(Slot) + capacity;
+		void* mem;
 		if (IS_NULL_POINTER(this->malloc_f))
-			ret = reinterpret_cast<Node*>(malloc(len * sizeof(Node)));
+			mem = malloc(bytes);
 		else
-			ret = reinterpret_cast<Node*>(this->malloc_f(len * sizeof(Node)));
-		for (size_t i = 0;i < len;++i)
-			new(&(ret[i])) Node();
-		return ret;
+			mem = this->malloc_f(bytes);
+		this->slots = reinterpret_cast<Slot*>(mem);
+		this->ctrl = reinterpret_cast<uint8_t*>(mem) + capacity * sizeof(Slot);
+		memset(this->ctrl, MAP_CTRL_EMPTY, capacity);
+		for (size_t i = 0;i < capacity;++i) {
+			this->kinitialize(&this->slots[i].k, 1);
+			this->vinitialize(&this->slots[i].v, 1);
+		}
+		this->capacity = capacity;
+		this->growth_left = MAP_MAX_LOAD(capacity);
 	}
 
-	void _DeleteTable(Node* table, size_t len) {
-		for (size_t i = 0;i < len;++i) {
-			this->kdeconstruct(table[i].k);
-			this->vdeconstruct(table[i].v);
+	void _DeleteTable() {
+		if (IS_NULL_POINTER(this->slots))
+			return;
+		for (size_t i = 0;i < this->capacity;++i) {
+			this->kdeconstruct(this->slots[i].k);
+			this->vdeconstruct(this->slots[i].v);
 		}
 		if (IS_NULL_POINTER(this->free_f))
-			free(table);
+			free(this->slots);
 		else
-			this->free_f(table);
+			this->free_f(this->slots);
+		this->slots = nullptr;
+		this->ctrl = nullptr;
+		this->capacity = 0;
+		this->growth_left = 0;
 	}
 
-	size_t _FindEmptyNode() {
-		while (!MAP_NODE_EMPTY(last_empty)) {
-			if (last_empty > 0)
-				--last_empty;
-			else
-				return this->size;
+	//Moves every element into a new table, dropping the deleted markers
+	void _Rehash(size_t capacity) {
+		Slot* old_slots = this->slots;
+		uint8_t* old_ctrl = this->ctrl;
+		size_t old_capacity = this->capacity;
+		this->_NewTable(capacity);
+		for (size_t i = 0;i < old_capacity;++i) {
+			if ((old_ctrl[i] & 0x80U) != 0)
+				continue;
+			uint32_t hk = this->hash_f(old_slots[i].k._node.data);
+			size_t dst = this->_FindFree(hk);
+			this->ctrl[dst] = static_cast<uint8_t>(hk & 0x7FU);
+			this->kcopy(this->slots[dst].k, std::move(old_slots[i].k._node.data));
+			this->vcopy(this->slots[dst].v, std::move(old_slots[i].v._node.data));
+		}
+		this->growth_left -= this->num;
+		for (size_t i = 0;i < old_capacity;++i) {
+			this->kdeconstruct(old_slots[i].k);
+			this->vdeconstruct(old_slots[i].v);
 		}
-		return last_empty;
+		if (IS_NULL_POINTER(this->free_f))
+			free(old_slots);
+		else
+			this->free_f(old_slots);
 	}
 
-	void _Expand() {
-		Node* t_old = this->table;
-		size_t s_old = this->size;
-		this->size *= 2;
-		this->num = 0;
-		this->last_empty = this->size - 1;
-		this->table = this->_NewTable(this->size);
-		for (size_t i = 0;i < s_old;++i) {
-			if ((t_old[i].flags & 0x1U) == 0)
-				continue;
-			this->_Set(t_old[i].k._node.data, t_old[i].hk, t_old[i].v._node.data);
+	//Slot holding key, capacity when absent. Groups are visited in
+	//triangular order, which reaches every group of a power of two table.
+	size_t _Find(const Tk& key, uint32_t hk) const {
+		if (this->capacity == 0)
+			return 0;
+		size_t group_mask = this->capacity / MAP_GROUP_WIDTH - 1;
+		size_t g = (hk >> 7) & group_mask;
+		uint8_t tag = static_cast<uint8_t>(hk & 0x7FU);
+		for (size_t step = 1;;++step) {
+			uint64_t group = MapLoadGroup(this->ctrl + g * MAP_GROUP_WIDTH);
+			for (uint64_t match = MapMatchTag(group, tag);match != 0;match &= match - 1) {
+				size_t i = g * MAP_GROUP_WIDTH + MapLowestByte(match);
+				if (this->slots[i].k._node.data == key)
+					return i;
+			}
+			if (MapMatchEmpty(group) != 0 || step > group_mask)
+				return this->capacity;
+			g = (g + step) & group_mask;
 		}
-		this->_DeleteTable(t_old, s_old);
 	}
 
-	void _Set(const Tk& key, uint32_t hk, const Tv& value) {
-		size_t mp = HASH_MOD(hk, this->size);
-		if (MAP_NODE_EMPTY(mp)) {
-			this->kcopy(MAP_NODE(mp).k, key);
-			MAP_NODE(mp).hk = hk;
-			this->vcopy(MAP_NODE(mp).v, value);
-			MAP_NODE_SET_USED(mp);
-			++this->num;
+	//First empty or deleted slot on the probe sequence of hk, the table must have one
+	size_t _FindFree(uint32_t hk) const {
+		size_t group_mask = this->capacity / MAP_GROUP_WIDTH - 1;
+		size_t g = (hk >> 7) & group_mask;
+		for (size_t step = 1;;++step) {
+			uint64_t avail = MapMatchEmptyOrDeleted(MapLoadGroup(this->ctrl + g * MAP_GROUP_WIDTH));
+			if (avail != 0)
+				return g * MAP_GROUP_WIDTH + MapLowestByte(avail);
+			g = (g + step) & group_mask;
 		}
-		else {
-			if (MAP_NODE(mp).k._node.data == key) {
-				this->vcopy(MAP_NODE(mp).v, value);
-			}
-			else {
-				if (HASH_MOD(MAP_NODE(mp).hk, this->size) != mp) {
-					size_t pre = HASH_MOD(MAP_NODE(mp).hk, this->size);
-					while (MAP_NODE(pre).next != mp)
-						pre = MAP_NODE(pre).next;
-					size_t empty = this->_FindEmptyNode();
-					if (empty >= this->size) {
-						this->_Expand();
-						this->_Set(key, hk, value);
-						return;
-					}
-					MAP_NODE(pre).next = empty;
-					MAP_NODE(empty) = MAP_NODE(mp);
-					MAP_NODE_SET_USED(empty);
-					MAP_NODE_FLAGS(mp) = 0;
-					this->kcopy(MAP_NODE(mp).k, key);
-					MAP_NODE(mp).hk = hk;
-					this->vcopy(MAP_NODE(mp).v, value);
-					MAP_NODE_SET_USED(mp);
-				}
-				else {
-					while (MAP_NODE_HAS_NEXT(mp)) {
-						mp = MAP_NODE(mp).next;
-						if (MAP_NODE(mp).k._node.data == key) {
-							this->vcopy(MAP_NODE(mp).v, value);
-							return;
-						}
-					}
-					size_t empty = this->_FindEmptyNode();
-					if (empty >= this->size) {
-						this->_Expand();
-						this->_Set(key, hk, value);
-						return;
-					}
-					MAP_NODE(mp).next = empty;
-					MAP_NODE_SET_HAS_NEXT(mp);
-					this->kcopy(MAP_NODE(empty).k, key);
-					MAP_NODE(empty).hk = hk;
-					this->vcopy(MAP_NODE(empty).v, value);
-					MAP_NODE_SET_USED(empty);
-				}
-				++this->num;
-			}
+	}
+
+	template<typename K, typename V>
+	void _Set(K&& key, uint32_t hk, V&& value) {
+		size_t i = this->_Find(key, hk);
+		if (i < this->capacity) {
+			this->vcopy(this->slots[i].v, std::forward<V>(value));
+			return;
 		}
+		if (this->growth_left == 0) {
+			if (this->capacity == 0)
+				this->_NewTable(_CapacityFor(this->initial_capacity));
+			//Mostly deleted markers, clean them up in place of growing
+			else if (this->num <= MAP_MAX_LOAD(this->capacity) / 2)
+				this->_Rehash(this->capacity);
+			else
+				this->_Rehash(this->capacity * 2);
+		}
+		i = this->_FindFree(hk);
+		if (this->ctrl[i] == MAP_CTRL_EMPTY)
+			--this->growth_left;
+		this->ctrl[i] = static_cast<uint8_t>(hk & 0x7FU);
+		this->kcopy(this->slots[i].k, std::forward<K>(key));
+		this->vcopy(this->slots[i].v, std::forward<V>(value));
+		++this->num;
 	}
 
 public:
 	class NodeRef {
-		Node* table = nullptr;
-		size_t mp;
+		Slot* slot = nullptr;
 
-		NodeRef(Node* table, size_t mp):table(table),mp(mp){}
+		NodeRef(Slot* slot):slot(slot){}
 		friend class Map;
 
 	public:
@@ -247,13 +306,13 @@ public:
 		};
 
 		bool IsNull() {
-			return IS_NULL_POINTER(this->table);
+			return IS_NULL_POINTER(this->slot);
 		}
 
 		Tv& Value() {
-			if(IS_NULL_POINTER(this->table))
+			if(IS_NULL_POINTER(this->slot))
 				throw NullMapNodeRef();
-			return this->table[mp].v._node.data;
+			return this->slot->v._node.data;
 		}
 	};
 
@@ -262,78 +321,125 @@ public:
 		MapKeyError() :std::runtime_error("Map key not exist") {}
 	};
 
-	Map(MAllocF* malloc_f = nullptr, FreeF* free_f = nullptr) :malloc_f(malloc_f), free_f(free_f) {
-		this->Clear();
+	//Nothing is allocated until the first Set, which makes room for
+	//initial_capacity elements
+	Map(MAllocF* malloc_f = nullptr, FreeF* free_f = nullptr, size_t initial_capacity = 0)
+		:initial_capacity(initial_capacity), malloc_f(malloc_f), free_f(free_f) {}
+
+	Map(const Map<Tk, Tv>&) = delete;
+	Map<Tk, Tv>& operator=(const Map<Tk, Tv>&) = delete;
+
+	//Takes the table of other, which is left empty
+	Map(Map<Tk, Tv>&& other):
+		slots(other.slots),
+		ctrl(other.ctrl),
+		capacity(other.capacity),
+		num(other.num),
+		growth_left(other.growth_left),
+		initial_capacity(other.initial_capacity),
+		malloc_f(other.malloc_f),
+		free_f(other.free_f) {
+		other.slots = nullptr;
+		other.ctrl = nullptr;
+		other.capacity = 0;
+		other.num = 0;
+		other.growth_left = 0;
+	}
+
+	Map<Tk, Tv>& operator=(Map<Tk, Tv>&& other) {
+		if (this == &other)
+			return *this;
+		this->_DeleteTable();
+		this->slots = other.slots;
+		this->ctrl = other.ctrl;
+		this->capacity = other.capacity;
+		this->num = other.num;
+		this->growth_left = other.growth_left;
+		this->initial_capacity = other.initial_capacity;
+		this->malloc_f = other.malloc_f;
+		this->free_f = other.free_f;
+		other.slots = nullptr;
+		other.ctrl = nullptr;
+		other.capacity = 0;
+		other.num = 0;
+		other.growth_left = 0;
+		return *this;
 	}
 
+	//Frees the table, the next Set allocates it again
 	void Clear() {
-		if(!IS_NULL_POINTER(this->table))
-			this->_DeleteTable(this->table, this->size);
-		this->table = this->_NewTable(512);
-		this->size = 512;
-		this->last_empty = this->size - 1;
+		this->_DeleteTable();
 		this->num = 0;
 	}
 
-	bool GetSize() const {
+	//Makes room for n elements without rehashing
+	void Reserve(size_t n) {
+		if (n <= this->num + this->growth_left)
+			return;
+		size_t capacity = _CapacityFor(n);
+		if (this->capacity == 0)
+			this->_NewTable(capacity);
+		else
+			this->_Rehash(capacity > this->capacity ? capacity : this->capacity);
+	}
+
+	size_t GetSize() const {
 		return this->num;
 	}
 
+	size_t GetCapacity() const {
+		return this->capacity;
+	}
+
 	NodeRef Find(const Tk& key) {
-		uint32_t hk = this->hash_f(key);
-		size_t mp = HASH_MOD(hk, this->size);
-		while (!MAP_NODE_EMPTY(mp)) {
-			if (MAP_NODE(mp).k._node.data == key)
-				return NodeRef(this->table, mp);
-			if (MAP_NODE_HAS_NEXT(mp))
-				mp = MAP_NODE(mp).next;
-			else
-				break;
-		}
-		return NodeRef(nullptr, 0);
+		size_t i = this->_Find(key, this->hash_f(key));
+		if (i >= this->capacity)
+			return NodeRef(nullptr);
+		return NodeRef(&this->slots[i]);
 	}
 
 	Tv& Get(const Tk& key) {
-		NodeRef& ret = this->Find(key);
-		if (ret.table == nullptr)
-			throw MapKeyError("Map key error");
+		NodeRef ret = this->Find(key);
+		if (ret.slot == nullptr)
+			throw MapKeyError();
 		else
-			return MAP_NODE(ret.mp).v._node.data;
+			return ret.slot->v._node.data;
 	}
 
 	void Set(const Tk& key, const Tv& value) {
 		this->_Set(key, this->hash_f(key), value);
 	}
 
+	void Set(const Tk& key, Tv&& value) {
+		this->_Set(key, this->hash_f(key), std::move(value));
+	}
+
+	void Set(Tk&& key, Tv&& value) {
+		uint32_t hk = this->hash_f(key);
+		this->_Set(std::move(key), hk, std::move(value));
+	}
+
 	void Remove(const Tk& key) {
-		NodeRef node = this->Get(key);
-		if (IS_NULL_POINTER(node.table))
+		size_t i = this->_Find(key, this->hash_f(key));
+		if (i >= this->capacity)
 			return;
-		size_t rm = node.mp;
-		if (HASH_MOD(MAP_NODE(rm).hk, this->size) == rm) {
-			if (MAP_NODE_HAS_NEXT(rm)) {
-				rm = MAP_NODE(rm).next;
-				MAP_NODE(node.mp) = MAP_NODE(rm);
-			}
+		this->kdeconstruct(this->slots[i].k);
+		this->vdeconstruct(this->slots[i].v);
+		//A group that still has an empty slot never stopped a probe from
+		//ending there, so the slot can become empty again
+		size_t g = i / MAP_GROUP_WIDTH * MAP_GROUP_WIDTH;
+		if (MapMatchEmpty(MapLoadGroup(this->ctrl + g)) != 0) {
+			this->ctrl[i] = MAP_CTRL_EMPTY;
+			++this->growth_left;
 		}
-		else {
-			size_t pre = HASH_MOD(MAP_NODE(rm).hk, this->size);
-			while (!MAP_NODE(pre).next == rm)
-				pre = MAP_NODE(pre).next;
-			if (MAP_NODE_HAS_NEXT(rm))
-				MAP_NODE(pre).next = MAP_NODE(rm).next;
-			else
-				MAP_NODE_SET_NO_NEXT(pre);
-		}
-		MAP_NODE(rm).flags = 0;
-		if (rm > this->last_empty)
-			last_empty = rm;
+		else
+			this->ctrl[i] = MAP_CTRL_DELETED;
 		--this->num;
 	}
 
 	~Map() {
-		this->_DeleteTable(this->table, this->size);
+		this->_DeleteTable();
 	}
 };
 
-#endif
\ No newline at end of file
+#endif
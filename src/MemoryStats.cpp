@@ -0,0 +1,665 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "MemoryStats.h"
+#include <cstdlib>
+#include <cstring>
+
+
+const char* memory_category_names[MEMORY_CATEGORY_NUM] = {
+	"paragraphs",
+	"codepoints",
+	"lines",
+	"glyphs",
+	"bidi",
+	"scratch",
+	"fonts",
+	"glyph_cache",
+	"atlas",
+	"shaping",
+};
+
+
+const char* MemoryCategoryName(int category) {
+	if (category < 0 || category >= MEMORY_CATEGORY_NUM)
+		return "unknown";
+	return memory_category_names[category];
+}
+
+
+size_t MemoryStats::GetTotalReserved() const {
+	size_t ret = 0;
+	for (int i = 0;i < MEMORY_CATEGORY_NUM;++i)
+		ret += this->categories[i].reserved;
+	return ret;
+}
+
+
+size_t MemoryStats::GetTotalUsed() const {
+	size_t ret = 0;
+	for (int i = 0;i < MEMORY_CATEGORY_NUM;++i)
+		ret += this->categories[i].used;
+	return ret;
+}
+
+
+MemoryAccount::MemoryAccount() {
+	for (int i = 0;i < MEMORY_CATEGORY_NUM;++i) {
+		this->reserved[i].store(0, std::memory_order_relaxed);
+		this->peak[i].store(0, std::memory_order_relaxed);
+		this->blocks[i].store(0, std::memory_order_relaxed);
+		this->limit[i] = SIZE_MAX;
+	}
+}
+
+
+void MemoryAccount::_Charge(int category, size_t size) {
+	size_t reserved = this->reserved[category].fetch_add(size, std::memory_order_relaxed) + size;
+	this->blocks[category].fetch_add(1, std::memory_order_relaxed);
+	size_t peak = this->peak[category].load(std::memory_order_relaxed);
+	while (reserved > peak && !this->peak[category].compare_exchange_weak(peak, reserved, std::memory_order_relaxed));
+}
+
+
+void MemoryAccount::_Credit(int category, size_t size) {
+	this->reserved[category].fetch_sub(size, std::memory_order_relaxed);
+	this->blocks[category].fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+void MemoryAccount::SetPool(MemoryPool* pool) {
+	this->pool = pool;
+}
+
+
+void MemoryAccount::SetAllocator(const MemoryAllocator* allocator) {
+	this->allocator = allocator;
+}
+
+
+void MemoryAccount::SetLimit(int category, size_t bytes) {
+	this->limit[category] = bytes;
+}
+
+
+bool MemoryAccount::IsOverLimit(int category) const {
+	return this->reserved[category].load(std::memory_order_relaxed) > this->limit[category];
+}
+
+
+void MemoryAccount::Fill(MemoryStats& stats) const {
+	for (int i = 0;i < MEMORY_CATEGORY_NUM;++i) {
+		stats.categories[i].reserved = this->reserved[i].load(std::memory_order_relaxed);
+		stats.categories[i].peak = this->peak[i].load(std::memory_order_relaxed);
+		stats.categories[i].blocks = this->blocks[i].load(std::memory_order_relaxed);
+	}
+	stats.pooled = this->pool == nullptr ? 0 : this->pool->GetReserved();
+}
+
+
+thread_local MemoryAccount* current_memory_account = nullptr;
+MemoryAccount global_memory_account;
+thread_local MemoryArena* current_memory_arena = nullptr;
+
+
+#define MEMORY_SOURCE_HEAP	0
+#define MEMORY_SOURCE_POOL	1
+#define MEMORY_SOURCE_ARENA	2
+#define MEMORY_SOURCE_HOOK	3
+
+//Keeps the payload aligned like malloc's own result
+union MemoryHeader {
+	struct {
+		MemoryAccount* account;
+		size_t size;
+		size_t capacity;
+		int category;
+		int source;
+	} info;
+	std::max_align_t align;
+};
+
+#define MEMORY_HEADER(mem) (reinterpret_cast<MemoryHeader*>(mem) - 1)
+
+//Blocks of a MemoryAllocator start with the allocator they came from
+union MemoryHookPrefix {
+	const MemoryAllocator* allocator;
+	std::max_align_t align;
+};
+
+#define MEMORY_HOOK_PREFIX(header) (reinterpret_cast<MemoryHookPrefix*>(header) - 1)
+#define MEMORY_IS_LIBRARY(category) ((category) == MEMORY_CATEGORY_BIDI || (category) == MEMORY_CATEGORY_SHAPING)
+
+#define MEMORY_IS_POOLED(category) ( \
+	(category) == MEMORY_CATEGORY_PARAGRAPHS \
+	|| (category) == MEMORY_CATEGORY_CODEPOINTS \
+	|| (category) == MEMORY_CATEGORY_LINES \
+	|| (category) == MEMORY_CATEGORY_GLYPHS)
+
+//Short lived blocks are recycled by power of two classes up to 1MB. At most
+//MEMORY_RECYCLE_DEPTH blocks of a class and MEMORY_RECYCLE_BUDGET bytes in
+//total are kept per thread.
+#define MEMORY_RECYCLE_MIN_SHIFT	4
+#define MEMORY_RECYCLE_MAX_SHIFT	20
+#define MEMORY_RECYCLE_CLASS_NUM	(MEMORY_RECYCLE_MAX_SHIFT - MEMORY_RECYCLE_MIN_SHIFT + 1)
+#define MEMORY_RECYCLE_DEPTH		32
+#define MEMORY_RECYCLE_BUDGET		(4 * 1024 * 1024)
+#define MEMORY_IS_RECYCLED(category) ( \
+	(category) == MEMORY_CATEGORY_SCRATCH \
+	|| (category) == MEMORY_CATEGORY_BIDI \
+	|| (category) == MEMORY_CATEGORY_SHAPING)
+
+//Trivially destructible so blocks freed by later thread_local or static
+//destructors still find it, MemoryRecycleCleaner empties it at thread exit
+struct MemoryRecycleBin {
+	MemoryHeader* blocks[MEMORY_RECYCLE_CLASS_NUM][MEMORY_RECYCLE_DEPTH];
+	size_t num[MEMORY_RECYCLE_CLASS_NUM];
+	size_t bytes;
+	bool closed;
+};
+
+thread_local MemoryRecycleBin memory_recycle_bin = {};
+thread_local uint64_t memory_heap_allocs = 0;
+
+struct MemoryRecycleCleaner {
+	~MemoryRecycleCleaner() {
+		for (int c = 0;c < MEMORY_RECYCLE_CLASS_NUM;++c) {
+			for (size_t i = 0;i < memory_recycle_bin.num[c];++i)
+				free(memory_recycle_bin.blocks[c][i]);
+			memory_recycle_bin.num[c] = 0;
+		}
+		memory_recycle_bin.bytes = 0;
+		memory_recycle_bin.closed = true;
+	}
+};
+
+thread_local MemoryRecycleCleaner memory_recycle_cleaner;
+
+
+//Class of a recyclable size, -1 when too large
+int MemoryRecycleClass(size_t size) {
+	int ret = 0;
+	while ((static_cast<size_t>(1) << (ret + MEMORY_RECYCLE_MIN_SHIFT)) < size) {
+		if (++ret >= MEMORY_RECYCLE_CLASS_NUM)
+			return -1;
+	}
+	return ret;
+}
+
+
+#define MEMORY_RECYCLE_CLASS_SIZE(c) (static_cast<size_t>(1) << ((c) + MEMORY_RECYCLE_MIN_SHIFT))
+
+
+MemoryHeader* MemoryHeapAlloc(size_t capacity) {
+	++memory_heap_allocs;
+	MemoryHeader* ret = reinterpret_cast<MemoryHeader*>(malloc(sizeof(MemoryHeader) + capacity));
+	if (ret != nullptr)
+		ret->info.capacity = capacity;
+	return ret;
+}
+
+
+MemoryHeader* MemoryHookAlloc(const MemoryAllocator* allocator, size_t capacity) {
+	void* mem = allocator->allocate(allocator->user, sizeof(MemoryHookPrefix) + sizeof(MemoryHeader) + capacity);
+	if (mem == nullptr)
+		return nullptr;
+	MemoryHookPrefix* prefix = reinterpret_cast<MemoryHookPrefix*>(mem);
+	prefix->allocator = allocator;
+	MemoryHeader* ret = reinterpret_cast<MemoryHeader*>(prefix + 1);
+	ret->info.capacity = capacity;
+	return ret;
+}
+
+
+void MemoryHookRelease(MemoryHeader* header) {
+	MemoryHookPrefix* prefix = MEMORY_HOOK_PREFIX(header);
+	prefix->allocator->release(prefix->allocator->user, prefix);
+}
+
+
+//////////////
+//MemoryPool//
+//////////////
+size_t MemoryPoolClassSize(int c) {
+	if (c % 2 == 0)
+		return static_cast<size_t>(1) << (MEMORY_POOL_MIN_SHIFT + c / 2);
+	return static_cast<size_t>(3) << (MEMORY_POOL_MIN_SHIFT + c / 2 - 1);
+}
+
+
+//Class of a pooled size, -1 when too large
+int MemoryPoolClass(size_t size) {
+	for (int c = 0;c < MEMORY_POOL_CLASS_NUM;++c)
+		if (size <= MemoryPoolClassSize(c))
+			return c;
+	return -1;
+}
+
+
+//Starts every slab, header sized so the blocks after it stay aligned
+union MemoryPoolSlab {
+	struct {
+		MemoryPoolSlab* next;
+		size_t blocks;
+		//Free blocks counted by Trim
+		size_t idle;
+	} info;
+	MemoryHeader align;
+};
+
+#define MEMORY_POOL_FREE_NEXT(header) (*reinterpret_cast<MemoryHeader**>((header) + 1))
+#define MEMORY_POOL_STRIDE(c) (sizeof(MemoryHeader) + MemoryPoolClassSize(c))
+
+
+MemoryPool::MemoryPool() {
+	for (int c = 0;c < MEMORY_POOL_CLASS_NUM;++c) {
+		this->free_blocks[c] = nullptr;
+		this->slab_blocks[c] = MEMORY_POOL_SLAB_MIN;
+		this->slabs[c] = nullptr;
+	}
+}
+
+
+MemoryHeader* MemoryPool::_Pop(int c) {
+	size_t stride = MEMORY_POOL_STRIDE(c);
+	if (this->free_blocks[c] == nullptr) {
+		size_t capacity = MemoryPoolClassSize(c);
+		size_t n = this->slab_blocks[c];
+		size_t bytes = sizeof(MemoryPoolSlab) + n * stride;
+		++memory_heap_allocs;
+		MemoryPoolSlab* slab = reinterpret_cast<MemoryPoolSlab*>(malloc(bytes));
+		if (slab == nullptr)
+			return nullptr;
+		slab->info.next = this->slabs[c];
+		slab->info.blocks = n;
+		this->slabs[c] = slab;
+		this->reserved += bytes;
+		unsigned char* p = reinterpret_cast<unsigned char*>(slab + 1);
+		for (size_t i = n;i > 0;--i) {
+			MemoryHeader* header = reinterpret_cast<MemoryHeader*>(p + (i - 1) * stride);
+			header->info.capacity = capacity;
+			MEMORY_POOL_FREE_NEXT(header) = this->free_blocks[c];
+			this->free_blocks[c] = header;
+		}
+		if ((n * 2) * stride <= MEMORY_POOL_SLAB_BYTES)
+			this->slab_blocks[c] = n * 2;
+	}
+	MemoryHeader* ret = this->free_blocks[c];
+	this->free_blocks[c] = MEMORY_POOL_FREE_NEXT(ret);
+	this->used += stride;
+	size_t idle = this->GetIdle();
+	if (idle < this->idle_floor)
+		this->idle_floor = idle;
+	return ret;
+}
+
+
+void MemoryPool::_Push(MemoryHeader* header) {
+	int c = MemoryPoolClass(header->info.capacity);
+	MEMORY_POOL_FREE_NEXT(header) = this->free_blocks[c];
+	this->free_blocks[c] = header;
+	this->used -= MEMORY_POOL_STRIDE(c);
+}
+
+
+size_t MemoryPool::GetReserved() const {
+	return this->reserved;
+}
+
+
+size_t MemoryPool::GetIdle() const {
+	return this->reserved - this->used;
+}
+
+
+//Merge sort of a singly linked list by address, next(node) is its link
+template<typename T, typename F>
+T* MemorySortList(T* head, F next) {
+	if (head == nullptr || next(head) == nullptr)
+		return head;
+	T* slow = head;
+	T* fast = next(head);
+	while (fast != nullptr && next(fast) != nullptr) {
+		slow = next(slow);
+		fast = next(next(fast));
+	}
+	T* b = next(slow);
+	next(slow) = nullptr;
+	T* a = MemorySortList(head, next);
+	b = MemorySortList(b, next);
+	T* ret = nullptr;
+	T** tail = &ret;
+	while (a != nullptr && b != nullptr) {
+		T*& lower = a < b ? a : b;
+		*tail = lower;
+		tail = &next(lower);
+		lower = next(lower);
+	}
+	*tail = a != nullptr ? a : b;
+	return ret;
+}
+
+
+MemoryHeader*& MemoryPoolFreeNext(MemoryHeader* header) {
+	return MEMORY_POOL_FREE_NEXT(header);
+}
+
+
+MemoryPoolSlab*& MemoryPoolSlabNext(MemoryPoolSlab* slab) {
+	return slab->info.next;
+}
+
+
+//Both lists sorted by address, so the free blocks of each slab follow each
+//other and are counted in one pass
+size_t MemoryPool::_TrimClass(int c) {
+	if (this->slabs[c] == nullptr)
+		return 0;
+	size_t stride = MEMORY_POOL_STRIDE(c);
+	this->free_blocks[c] = MemorySortList(this->free_blocks[c], MemoryPoolFreeNext);
+	this->slabs[c] = MemorySortList(this->slabs[c], MemoryPoolSlabNext);
+	MemoryHeader* block = this->free_blocks[c];
+	for (MemoryPoolSlab* slab = this->slabs[c];slab != nullptr;slab = slab->info.next) {
+		unsigned char* end = reinterpret_cast<unsigned char*>(slab + 1) + slab->info.blocks * stride;
+		slab->info.idle = 0;
+		while (block != nullptr && reinterpret_cast<unsigned char*>(block) < end) {
+			++slab->info.idle;
+			block = MEMORY_POOL_FREE_NEXT(block);
+		}
+	}
+	//Drops the blocks of the idle slabs from the free list, then the slabs
+	MemoryHeader** link = &this->free_blocks[c];
+	for (MemoryPoolSlab* slab = this->slabs[c];slab != nullptr;slab = slab->info.next) {
+		for (size_t i = 0;i < slab->info.idle;++i) {
+			if (slab->info.idle == slab->info.blocks)
+				*link = MEMORY_POOL_FREE_NEXT(*link);
+			else
+				link = &MEMORY_POOL_FREE_NEXT(*link);
+		}
+	}
+	size_t ret = 0;
+	MemoryPoolSlab** slab_link = &this->slabs[c];
+	while (*slab_link != nullptr) {
+		MemoryPoolSlab* slab = *slab_link;
+		if (slab->info.idle < slab->info.blocks) {
+			slab_link = &slab->info.next;
+			continue;
+		}
+		*slab_link = slab->info.next;
+		ret += sizeof(MemoryPoolSlab) + slab->info.blocks * stride;
+		free(slab);
+	}
+	//Grows from small slabs again once the class is empty
+	if (this->slabs[c] == nullptr)
+		this->slab_blocks[c] = MEMORY_POOL_SLAB_MIN;
+	return ret;
+}
+
+
+size_t MemoryPool::Trim() {
+	size_t ret = 0;
+	for (int c = 0;c < MEMORY_POOL_CLASS_NUM;++c)
+		ret += this->_TrimClass(c);
+	this->reserved -= ret;
+	this->idle_floor = this->GetIdle();
+	return ret;
+}
+
+
+size_t MemoryPool::TrimIdle() {
+	if (this->GetIdle() < this->idle_floor + MEMORY_POOL_TRIM_IDLE)
+		return 0;
+	return this->Trim();
+}
+
+
+MemoryPool::~MemoryPool() {
+	for (int c = 0;c < MEMORY_POOL_CLASS_NUM;++c) {
+		while (this->slabs[c] != nullptr) {
+			MemoryPoolSlab* next = this->slabs[c]->info.next;
+			free(this->slabs[c]);
+			this->slabs[c] = next;
+		}
+	}
+}
+
+
+///////////////
+//MemoryArena//
+///////////////
+#define MEMORY_ARENA_PAYLOAD(chunk) (reinterpret_cast<unsigned char*>((chunk) + 1))
+#define MEMORY_ARENA_ALIGN(size) (((size) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t))
+
+
+void* MemoryArena::_Alloc(size_t size) {
+	size = MEMORY_ARENA_ALIGN(size);
+	Chunk* c = this->current;
+	if (c != nullptr && c->info.used + size <= c->info.capacity) {
+		void* ret = MEMORY_ARENA_PAYLOAD(c) + c->info.used;
+		c->info.used += size;
+		return ret;
+	}
+	//Chunks after the current one are left from before the last rewind
+	Chunk* next = c == nullptr ? this->head : c->info.next;
+	if (next == nullptr || next->info.capacity < size) {
+		size_t capacity = c == nullptr ? MEMORY_ARENA_CHUNK_MIN : c->info.capacity * 2;
+		if (capacity > MEMORY_ARENA_CHUNK_MAX)
+			capacity = MEMORY_ARENA_CHUNK_MAX;
+		if (capacity < size)
+			capacity = size;
+		++memory_heap_allocs;
+		Chunk* chunk = reinterpret_cast<Chunk*>(malloc(sizeof(Chunk) + capacity));
+		if (chunk == nullptr)
+			return nullptr;
+		chunk->info.capacity = capacity;
+		chunk->info.next = next;
+		if (c == nullptr)
+			this->head = chunk;
+		else
+			c->info.next = chunk;
+		this->reserved += sizeof(Chunk) + capacity;
+		next = chunk;
+	}
+	next->info.used = size;
+	this->current = next;
+	return MEMORY_ARENA_PAYLOAD(next);
+}
+
+
+//Frees the chunks past the first keep bytes, the arena must be rewound to the start
+void MemoryArena::_Trim(size_t keep) {
+	size_t kept = 0;
+	Chunk** link = &this->head;
+	while (*link != nullptr) {
+		Chunk* chunk = *link;
+		size_t bytes = sizeof(Chunk) + chunk->info.capacity;
+		if (kept + bytes <= keep) {
+			kept += bytes;
+			link = &chunk->info.next;
+			continue;
+		}
+		*link = chunk->info.next;
+		this->reserved -= bytes;
+		free(chunk);
+	}
+}
+
+
+size_t MemoryArena::GetReserved() const {
+	return this->reserved;
+}
+
+
+MemoryArena::~MemoryArena() {
+	while (this->head != nullptr) {
+		Chunk* next = this->head->info.next;
+		free(this->head);
+		this->head = next;
+	}
+}
+
+
+MemoryArenaScope::MemoryArenaScope(MemoryArena* arena) :prev(current_memory_arena), arena(arena) {
+	current_memory_arena = arena;
+	if (arena != nullptr) {
+		this->chunk = arena->current;
+		this->used = arena->current == nullptr ? 0 : arena->current->info.used;
+	}
+}
+
+
+MemoryArenaScope::~MemoryArenaScope() {
+	if (this->arena != nullptr) {
+		this->arena->current = this->chunk;
+		if (this->chunk != nullptr)
+			this->chunk->info.used = this->used;
+		//Outermost scope of the arena, a large edit should not pin its chunks
+		else if (this->prev != this->arena)
+			this->arena->_Trim(MEMORY_ARENA_KEEP);
+	}
+	current_memory_arena = this->prev;
+}
+
+
+void* MemoryAlloc(int category, size_t size) {
+	MemoryAccount* account = current_memory_account;
+	if (account == nullptr)
+		account = &global_memory_account;
+	MemoryHeader* header = nullptr;
+	int source = MEMORY_SOURCE_HEAP;
+	int c;
+	if (account->allocator != nullptr && MEMORY_IS_LIBRARY(category)) {
+		header = MemoryHookAlloc(account->allocator, size);
+		source = MEMORY_SOURCE_HOOK;
+	}
+	else if (category == MEMORY_CATEGORY_SCRATCH && current_memory_arena != nullptr) {
+		header = reinterpret_cast<MemoryHeader*>(current_memory_arena->_Alloc(sizeof(MemoryHeader) + size));
+		if (header != nullptr)
+			header->info.capacity = MEMORY_ARENA_ALIGN(size);
+		source = MEMORY_SOURCE_ARENA;
+	}
+	else if (account->pool != nullptr && MEMORY_IS_POOLED(category) && (c = MemoryPoolClass(size)) >= 0) {
+		header = account->pool->_Pop(c);
+		source = MEMORY_SOURCE_POOL;
+	}
+	else {
+		c = MEMORY_IS_RECYCLED(category) ? MemoryRecycleClass(size) : -1;
+		if (c < 0)
+			header = MemoryHeapAlloc(size);
+		else if (memory_recycle_bin.num[c] > 0) {
+			header = memory_recycle_bin.blocks[c][--memory_recycle_bin.num[c]];
+			memory_recycle_bin.bytes -= header->info.capacity;
+		}
+		else
+			header = MemoryHeapAlloc(MEMORY_RECYCLE_CLASS_SIZE(c));
+	}
+	if (header == nullptr)
+		return nullptr;
+	header->info.account = account;
+	header->info.size = size;
+	header->info.category = category;
+	header->info.source = source;
+	account->_Charge(category, size);
+	return header + 1;
+}
+
+
+void* MemoryAllocOrThrow(int category, size_t size) {
+	void* ret = MemoryAlloc(category, size);
+	if (ret == nullptr)
+		throw std::bad_alloc();
+	return ret;
+}
+
+
+void* MemoryRealloc(void* mem, size_t size) {
+	if (mem == nullptr)
+		return nullptr;
+	MemoryHeader* header = MEMORY_HEADER(mem);
+	MemoryAccount* account = header->info.account;
+	int category = header->info.category;
+	size_t old_size = header->info.size;
+	bool from_heap = header->info.source == MEMORY_SOURCE_HEAP;
+	if (size <= header->info.capacity && (!from_heap || MEMORY_IS_RECYCLED(category))) {
+		account->_Credit(category, old_size);
+		account->_Charge(category, size);
+		header->info.size = size;
+		return mem;
+	}
+	if (header->info.source == MEMORY_SOURCE_HOOK && MEMORY_HOOK_PREFIX(header)->allocator->reallocate != nullptr) {
+		const MemoryAllocator* allocator = MEMORY_HOOK_PREFIX(header)->allocator;
+		void* prefix = allocator->reallocate(
+			allocator->user,
+			MEMORY_HOOK_PREFIX(header),
+			sizeof(MemoryHookPrefix) + sizeof(MemoryHeader) + size
+		);
+		if (prefix == nullptr)
+			return nullptr;
+		header = reinterpret_cast<MemoryHeader*>(reinterpret_cast<MemoryHookPrefix*>(prefix) + 1);
+		account->_Credit(category, old_size);
+		account->_Charge(category, size);
+		header->info.size = size;
+		header->info.capacity = size;
+		return header + 1;
+	}
+	if (!from_heap || (MemoryRecycleClass(size) >= 0 && MEMORY_IS_RECYCLED(category))) {
+		//Move to a larger block, charged to the account of the old block
+		MemoryAccountScope scope(account);
+		void* ret = MemoryAlloc(category, size);
+		if (ret == nullptr)
+			return nullptr;
+		memcpy(ret, mem, old_size);
+		MemoryRelease(mem);
+		return ret;
+	}
+	++memory_heap_allocs;
+	header = reinterpret_cast<MemoryHeader*>(realloc(header, sizeof(MemoryHeader) + size));
+	if (header == nullptr)
+		return nullptr;
+	account->_Credit(category, old_size);
+	account->_Charge(category, size);
+	header->info.size = size;
+	header->info.capacity = size;
+	return header + 1;
+}
+
+
+void MemoryRelease(void* mem) {
+	if (mem == nullptr)
+		return;
+	MemoryHeader* header = MEMORY_HEADER(mem);
+	int category = header->info.category;
+	header->info.account->_Credit(category, header->info.size);
+	//Arena blocks go away when the arena is rewound
+	if (header->info.source == MEMORY_SOURCE_ARENA)
+		return;
+	if (header->info.source == MEMORY_SOURCE_POOL) {
+		header->info.account->pool->_Push(header);
+		return;
+	}
+	if (header->info.source == MEMORY_SOURCE_HOOK) {
+		MemoryHookRelease(header);
+		return;
+	}
+	if (MEMORY_IS_RECYCLED(category) && !memory_recycle_bin.closed) {
+		int c = MemoryRecycleClass(header->info.capacity);
+		if (
+			c >= 0 
+			&& MEMORY_RECYCLE_CLASS_SIZE(c) == header->info.capacity 
+			&& memory_recycle_bin.num[c] < MEMORY_RECYCLE_DEPTH
+			&& memory_recycle_bin.bytes + header->info.capacity <= MEMORY_RECYCLE_BUDGET
+			) {
+			//Registers the cleaner of this thread on first use
+			static_cast<void>(&memory_recycle_cleaner);
+			memory_recycle_bin.blocks[c][memory_recycle_bin.num[c]++] = header;
+			memory_recycle_bin.bytes += header->info.capacity;
+			return;
+		}
+	}
+	free(header);
+}
+
+
+uint64_t MemoryGetHeapAllocCount() {
+	return memory_heap_allocs;
+}
@@ -0,0 +1,261 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "MAllocUtils.h"
+
+//TextEngine
+#define MEMORY_CATEGORY_PARAGRAPHS	0	//Paragraph objects, TextEngine::paragraphs and its index
+#define MEMORY_CATEGORY_CODEPOINTS	1	//Paragraph::cps
+#define MEMORY_CATEGORY_LINES		2	//Paragraph::lines and TextLine objects
+#define MEMORY_CATEGORY_GLYPHS		3	//TextLine::glyphs
+#define MEMORY_CATEGORY_BIDI		4	//SheenBidi objects retained by Paragraph
+#define MEMORY_CATEGORY_SCRATCH		5	//Temporaries of a single edit
+//FontCollection
+#define MEMORY_CATEGORY_FONTS		6	//Font objects
+#define MEMORY_CATEGORY_GLYPH_CACHE	7	//Font::glyph_cache
+#define MEMORY_CATEGORY_ATLAS		8	//Atlas textures, regions and packers
+//Libraries
+#define MEMORY_CATEGORY_SHAPING		9	//HarfBuzz, always charged to global_memory_account
+#define MEMORY_CATEGORY_NUM		10
+
+struct MemoryCategoryStats {
+	size_t reserved = 0;		//Bytes currently allocated through the hooks
+	size_t used = 0;		//Bytes of reserved holding live data
+	size_t peak = 0;		//Highest reserved seen
+	size_t blocks = 0;		//Live allocations
+};
+
+
+struct MemoryStats {
+	MemoryCategoryStats categories[MEMORY_CATEGORY_NUM];
+	size_t pooled = 0;		//Bytes of the owner's size class pools, live blocks included
+	size_t arena = 0;		//Bytes of the owner's arena chunks
+
+	size_t GetTotalReserved() const;
+	size_t GetTotalUsed() const;
+};
+
+const char* MemoryCategoryName(int category);
+
+
+union MemoryHeader;
+
+//Size class pools, 32B to 8KB in steps of 1x and 1.5x powers of two.
+//Each class takes blocks from its own slabs, the first holding
+//MEMORY_POOL_SLAB_MIN blocks and the next ones doubling up to
+//MEMORY_POOL_SLAB_BYTES.
+#define MEMORY_POOL_MIN_SHIFT	5
+#define MEMORY_POOL_MAX_SHIFT	13
+#define MEMORY_POOL_CLASS_NUM	((MEMORY_POOL_MAX_SHIFT - MEMORY_POOL_MIN_SHIFT) * 2 + 1)
+#define MEMORY_POOL_SLAB_MIN	2
+#define MEMORY_POOL_SLAB_BYTES	(64 * 1024)
+//Bytes of free blocks piling up since the last Trim that make TrimIdle trim
+#define MEMORY_POOL_TRIM_IDLE	(4 * MEMORY_POOL_SLAB_BYTES)
+
+union MemoryPoolSlab;
+
+//Blocks of the long lived categories of one account, see MemoryAccount::SetPool.
+//Freeing a block only puts it back on its class list, slabs are returned by
+//Trim once none of their blocks is live.
+class MemoryPool {
+	friend void* MemoryAlloc(int category, size_t size);
+	friend void MemoryRelease(void* mem);
+
+	MemoryHeader* free_blocks[MEMORY_POOL_CLASS_NUM];
+	size_t slab_blocks[MEMORY_POOL_CLASS_NUM];
+	MemoryPoolSlab* slabs[MEMORY_POOL_CLASS_NUM];
+	size_t reserved = 0;
+	//Bytes of live blocks, headers included
+	size_t used = 0;
+	//Lowest free block bytes since the last Trim
+	size_t idle_floor = 0;
+
+	MemoryHeader* _Pop(int c);
+	void _Push(MemoryHeader* header);
+	size_t _TrimClass(int c);
+
+public:
+	MemoryPool();
+	MemoryPool(const MemoryPool&) = delete;
+	MemoryPool& operator=(const MemoryPool&) = delete;
+	size_t GetReserved() const;
+	//Bytes of the slabs held by free blocks
+	size_t GetIdle() const;
+	//Frees the slabs of every class none of whose blocks is live, returns the
+	//bytes given back. O(n log n) of the free blocks.
+	size_t Trim();
+	//Trim once MEMORY_POOL_TRIM_IDLE more bytes are free than at the lowest
+	//point since the last one, for owners to call after large frees
+	size_t TrimIdle();
+	~MemoryPool();
+};
+
+
+//Allocator of the library blocks charged to an account, see
+//MemoryAccount::SetAllocator. Results must be aligned like malloc's.
+//reallocate may be nullptr, blocks are then moved with allocate and release.
+struct MemoryAllocator {
+	void* (*allocate)(void* user, size_t size);
+	void* (*reallocate)(void* user, void* mem, size_t size);
+	void (*release)(void* user, void* mem);
+	void* user;
+};
+
+
+//Byte counters of one owner (a TextEngine or a FontCollection). Every tracked
+//block carries a header pointing at the account it was charged to, so it is
+//credited back to the same account whichever thread or scope frees it. The
+//counters are atomic since global_memory_account is charged from any thread.
+class MemoryAccount {
+	friend void* MemoryAlloc(int category, size_t size);
+	friend void* MemoryRealloc(void* mem, size_t size);
+	friend void MemoryRelease(void* mem);
+
+	std::atomic<size_t> reserved[MEMORY_CATEGORY_NUM];
+	std::atomic<size_t> peak[MEMORY_CATEGORY_NUM];
+	std::atomic<size_t> blocks[MEMORY_CATEGORY_NUM];
+	size_t limit[MEMORY_CATEGORY_NUM];
+	MemoryPool* pool = nullptr;
+	const MemoryAllocator* allocator = nullptr;
+
+	void _Charge(int category, size_t size);
+	void _Credit(int category, size_t size);
+
+public:
+	MemoryAccount();
+	//Paragraph, codepoint, line and glyph blocks charged to this account come
+	//from pool, which must outlive all of them
+	void SetPool(MemoryPool* pool);
+	//SheenBidi and HarfBuzz blocks charged to this account come from allocator
+	//instead of the per-thread recycle bin, nullptr to go back to it. Blocks
+	//are returned to the allocator they came from, which must outlive them.
+	void SetAllocator(const MemoryAllocator* allocator);
+	//Soft limit of category, SIZE_MAX by default. Allocations never fail
+	//because of it, owners check IsOverLimit and drop what they can rebuild.
+	void SetLimit(int category, size_t bytes);
+	bool IsOverLimit(int category) const;
+	void Fill(MemoryStats& stats) const;
+};
+
+
+//Account charged by the hooks on this thread, global_memory_account when null
+extern thread_local MemoryAccount* current_memory_account;
+extern MemoryAccount global_memory_account;
+
+class MemoryAccountScope {
+	MemoryAccount* prev;
+
+public:
+	MemoryAccountScope(MemoryAccount* account) :prev(current_memory_account) {
+		current_memory_account = account;
+	}
+	~MemoryAccountScope() {
+		current_memory_account = this->prev;
+	}
+};
+
+#define _MEMORY_CONCAT(a,b) a##b
+#define MEMORY_CONCAT(a,b) _MEMORY_CONCAT(a,b)
+#define MEMORY_SCOPE(account) MemoryAccountScope MEMORY_CONCAT(_memory_scope_,__LINE__)(account)
+
+
+#define MEMORY_ARENA_CHUNK_MIN	1024
+#define MEMORY_ARENA_CHUNK_MAX	(1024 * 1024)
+#define MEMORY_ARENA_KEEP		(64 * 1024)
+
+//Bump allocator serving MEMORY_CATEGORY_SCRATCH while it is current, see
+//MemoryArenaScope. Chunks are kept when the arena is rewound, up to
+//MEMORY_ARENA_KEEP bytes once the outermost scope ends.
+class MemoryArena {
+	friend class MemoryArenaScope;
+	friend void* MemoryAlloc(int category, size_t size);
+
+	union Chunk {
+		struct {
+			Chunk* next;
+			size_t capacity;
+			size_t used;
+		} info;
+		std::max_align_t align;
+	};
+
+	Chunk* head = nullptr;
+	//Chunk allocations are taken from, nullptr before the first
+	Chunk* current = nullptr;
+	size_t reserved = 0;
+
+	void* _Alloc(size_t size);
+	void _Trim(size_t keep);
+
+public:
+	MemoryArena() {}
+	MemoryArena(const MemoryArena&) = delete;
+	MemoryArena& operator=(const MemoryArena&) = delete;
+	size_t GetReserved() const;
+	~MemoryArena();
+};
+
+//Arena serving scratch allocations on this thread, the recycle bin when null
+extern thread_local MemoryArena* current_memory_arena;
+
+//Makes arena current and drops everything it hands out within the scope in
+//O(1) when the scope ends. Scratch containers must not outlive the scope.
+class MemoryArenaScope {
+	MemoryArena* prev;
+	MemoryArena* arena;
+	MemoryArena::Chunk* chunk = nullptr;
+	size_t used = 0;
+
+public:
+	MemoryArenaScope(MemoryArena* arena);
+	~MemoryArenaScope();
+};
+
+#define MEMORY_ARENA_SCOPE(arena) MemoryArenaScope MEMORY_CONCAT(_memory_arena_scope_,__LINE__)(arena)
+//Drops the scratch allocations of the scope from whichever arena is current
+#define MEMORY_ARENA_MARK() MEMORY_ARENA_SCOPE(current_memory_arena)
+
+
+void* MemoryAlloc(int category, size_t size);
+void* MemoryRealloc(void* mem, size_t size);
+void MemoryRelease(void* mem);
+
+//Calls the hooks made to malloc/realloc on this thread. Blocks of
+//MEMORY_CATEGORY_SCRATCH, MEMORY_CATEGORY_BIDI and MEMORY_CATEGORY_SHAPING
+//freed on a thread are kept there by size class and reused, those
+//allocations are not counted.
+uint64_t MemoryGetHeapAllocCount();
+
+//MAllocF/FreeF hooks for the containers
+template<int category>
+void* MemoryMalloc(size_t size) {
+	return MemoryAlloc(category, size);
+}
+
+inline void MemoryFree(void* mem) {
+	MemoryRelease(mem);
+}
+
+//Class scope operator new/delete charging a category
+void* MemoryAllocOrThrow(int category, size_t size);
+
+#define MEMORY_TRACKED_NEW(category) \
+	static void* operator new(size_t size) { return MemoryAllocOrThrow(category, size); } \
+	static void operator delete(void* mem) { MemoryRelease(mem); } \
+	static void* operator new[](size_t size) { return MemoryAllocOrThrow(category, size); } \
+	static void operator delete[](void* mem) { MemoryRelease(mem); }
+
+#define MEMORY_HOOKS(category) MemoryMalloc<category>, MemoryFree
+
+//Route SheenBidi's allocations through MEMORY_CATEGORY_BIDI. Must run before
+//any SheenBidi object is created, TextEngine's constructor calls it.
+void MemoryInstallBidiAllocator();
+
+#endif
@@ -0,0 +1,156 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "ParagraphIndex.h"
+#include "MemoryStats.h"
+
+#define LOW_BIT(i) ((i) & (~(i) + 1))
+
+
+ParagraphIndex::ParagraphIndex():
+	extents(128, MEMORY_HOOKS(MEMORY_CATEGORY_PARAGRAPHS)),
+	tree(128, MEMORY_HOOKS(MEMORY_CATEGORY_PARAGRAPHS)) {}
+
+
+//Stale nodes are computed in order, each from its extent and the nodes it
+//covers, which come before it
+void ParagraphIndex::_Update() {
+	size_t n = this->extents.GetSize();
+	if (this->valid == n)
+		return;
+	this->tree.Truncate(this->valid);
+	for (size_t i = this->valid + 1;i <= n;++i) {
+		const ParagraphExtent& extent = this->extents.GetUnchecked(i - 1);
+		ParagraphSums sums;
+		sums.bytes = extent.bytes + extent.newline;
+		sums.cps = extent.cps + extent.newline;
+		size_t low = i - LOW_BIT(i);
+		for (size_t j = i - 1;j > low;j -= LOW_BIT(j)) {
+			const ParagraphSums& child = this->tree.GetUnchecked(j - 1);
+			sums.bytes += child.bytes;
+			sums.cps += child.cps;
+		}
+		this->tree.Push(sums);
+	}
+	this->valid = n;
+}
+
+
+//Deltas wrap around when they shrink, the sums come out right anyway
+void ParagraphIndex::_Add(size_t index, size_t bytes, size_t cps) {
+	for (size_t i = index + 1;i <= this->valid;i += LOW_BIT(i)) {
+		ParagraphSums& node = this->tree.GetUnchecked(i - 1);
+		node.bytes += bytes;
+		node.cps += cps;
+	}
+}
+
+
+size_t ParagraphIndex::_Find(size_t offset, bool bytes, size_t& local) {
+	this->_Update();
+	size_t n = this->extents.GetSize();
+	size_t step = 1;
+	while (step <= n / 2)
+		step <<= 1;
+	size_t pos = 0;
+	for (;step > 0 && n > 0;step >>= 1) {
+		if (pos + step > n)
+			continue;
+		const ParagraphSums& node = this->tree.GetUnchecked(pos + step - 1);
+		size_t value = bytes ? node.bytes : node.cps;
+		if (value <= offset) {
+			pos += step;
+			offset -= value;
+		}
+	}
+	local = offset;
+	return pos;
+}
+
+
+size_t ParagraphIndex::GetSize() const {
+	return this->extents.GetSize();
+}
+
+
+const ParagraphExtent& ParagraphIndex::Get(size_t index) const {
+	return this->extents.Get(index);
+}
+
+
+void ParagraphIndex::Insert(size_t index, size_t n) {
+	if (n == 1)
+		this->extents.Insert(index, ParagraphExtent());
+	else if (n > 1) {
+		Array<ParagraphExtent> empty(128, MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+		empty.AppendSpans(n, [](ParagraphExtent* span, size_t m) {
+			for (size_t i = 0;i < m;++i)
+				span[i] = ParagraphExtent();
+		});
+		this->extents.InsertRange(index, empty, 0, n);
+	}
+	if (this->valid > index)
+		this->valid = index;
+}
+
+
+void ParagraphIndex::Remove(size_t index, size_t n) {
+	this->extents.RemoveRange(index, n);
+	if (this->valid > index)
+		this->valid = index;
+}
+
+
+void ParagraphIndex::Clear() {
+	this->extents.Clear();
+	this->tree.Clear();
+	this->valid = 0;
+}
+
+
+void ParagraphIndex::Set(size_t index, const ParagraphExtent& extent) {
+	ParagraphExtent& old = this->extents.Get(index);
+	this->_Add(
+		index,
+		(extent.bytes + extent.newline) - (old.bytes + old.newline),
+		(extent.cps + extent.newline) - (old.cps + old.newline)
+	);
+	old = extent;
+}
+
+
+void ParagraphIndex::Grow(size_t index, size_t bytes, size_t cps) {
+	ParagraphExtent& extent = this->extents.Get(index);
+	extent.bytes += bytes;
+	extent.cps += cps;
+	this->_Add(index, bytes, cps);
+}
+
+
+ParagraphSums ParagraphIndex::GetPrefix(size_t index) {
+	this->_Update();
+	ParagraphSums ret;
+	for (size_t i = index;i > 0;i -= LOW_BIT(i)) {
+		const ParagraphSums& node = this->tree.GetUnchecked(i - 1);
+		ret.bytes += node.bytes;
+		ret.cps += node.cps;
+	}
+	return ret;
+}
+
+
+size_t ParagraphIndex::FindByte(size_t offset, size_t& local) {
+	return this->_Find(offset, true, local);
+}
+
+
+size_t ParagraphIndex::FindCodepoint(size_t offset, size_t& local) {
+	return this->_Find(offset, false, local);
+}
+
+
+//Inline extents and nodes are part of the engine, not its allocations
+size_t ParagraphIndex::GetUsedBytes() const {
+	size_t n = this->extents.GetSize();
+	return n > INLINE_INDEX_NUM ? n * (sizeof(ParagraphExtent) + sizeof(ParagraphSums)) : 0;
+}
@@ -0,0 +1,63 @@
+#ifndef PARAGRAPH_INDEX_H
+#define PARAGRAPH_INDEX_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include "Array.h"
+
+//Paragraphs counted inline, same as the paragraphs of an engine
+#define INLINE_INDEX_NUM	1
+
+//Text of one paragraph as TextEngine::GetText exports it
+struct ParagraphExtent {
+	size_t bytes = 0;		//UTF-8 of its codepoints
+	size_t cps = 0;
+	size_t newline = 1;		//0 if it ends with a separator of its own
+};
+
+
+struct ParagraphSums {
+	size_t bytes = 0;
+	size_t cps = 0;
+};
+
+
+//Prefix sums of paragraph extents, newlines included, in a Fenwick tree so
+//offsets convert to paragraphs in O(log n). Changing an extent updates the
+//tree at once. Inserting or removing paragraphs only shifts the extents, the
+//nodes from there on are rebuilt by the next query.
+class ParagraphIndex {
+	Array<ParagraphExtent, INLINE_INDEX_NUM> extents;
+	//Node i covers the extents (i - lowbit(i), i] and is stored at i - 1
+	Array<ParagraphSums, INLINE_INDEX_NUM> tree;
+	//Nodes up to valid are up to date
+	size_t valid = 0;
+
+	void _Update();
+	void _Add(size_t index, size_t bytes, size_t cps);
+	size_t _Find(size_t offset, bool bytes, size_t& local);
+
+public:
+	ParagraphIndex();
+	size_t GetSize() const;
+	const ParagraphExtent& Get(size_t index) const;
+	//Adds n empty paragraphs before index
+	void Insert(size_t index, size_t n);
+	void Remove(size_t index, size_t n);
+	void Clear();
+	void Set(size_t index, const ParagraphExtent& extent);
+	//Codepoints appended to a paragraph, its newline is left as it is
+	void Grow(size_t index, size_t bytes, size_t cps);
+	//Sums of the paragraphs before index
+	ParagraphSums GetPrefix(size_t index);
+	//Paragraph holding offset and the offset within it, the size if offset is
+	//past the last newline
+	size_t FindByte(size_t offset, size_t& local);
+	size_t FindCodepoint(size_t offset, size_t& local);
+	size_t GetUsedBytes() const;
+};
+
+#endif
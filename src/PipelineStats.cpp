@@ -0,0 +1,74 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "PipelineStats.h"
+#include <chrono>
+
+
+const char* pipeline_stage_names[PIPELINE_STAGE_NUM] = {
+	"utf8_decode",
+	"line_break",
+	"bidi",
+	"script_split",
+	"shape",
+	"rasterize",
+	"atlas_pack",
+	"layout",
+};
+
+
+const char* PipelineStageName(int stage) {
+	if (stage < 0 || stage >= PIPELINE_STAGE_NUM)
+		return "unknown";
+	return pipeline_stage_names[stage];
+}
+
+
+uint64_t PipelineStatsNow() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count());
+}
+
+
+#ifdef TEXT_ENGINE_STATS
+
+thread_local PipelineStats* current_pipeline_stats = nullptr;
+
+
+PipelineEditScope::PipelineEditScope(PipelineStats* stats) :prev(current_pipeline_stats), start(0) {
+	//Nested calls (Replace calling Delete and Insert) belong to the outer edit
+	if (this->prev == stats)
+		return;
+	current_pipeline_stats = stats;
+	for (int i = 0;i < PIPELINE_STAGE_NUM;++i) {
+		stats->stages[i].last_edit_count = 0;
+		stats->stages[i].last_edit_ns = 0;
+	}
+	this->start = PipelineStatsNow();
+}
+
+
+PipelineEditScope::~PipelineEditScope() {
+	if (current_pipeline_stats == this->prev)
+		return;
+	uint64_t dt = PipelineStatsNow() - this->start;
+	current_pipeline_stats->edits += 1;
+	current_pipeline_stats->total_edit_ns += dt;
+	current_pipeline_stats->last_edit_ns = dt;
+	current_pipeline_stats = this->prev;
+}
+
+
+PipelineStageTimer::~PipelineStageTimer() {
+	if (current_pipeline_stats == nullptr)
+		return;
+	uint64_t dt = PipelineStatsNow() - this->start;
+	StageStats& stage = current_pipeline_stats->stages[this->stage];
+	stage.count += 1;
+	stage.total_ns += dt;
+	stage.last_edit_count += 1;
+	stage.last_edit_ns += dt;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+
+#define PIPELINE_STAGE_UTF8_DECODE	0
+#define PIPELINE_STAGE_LINE_BREAK	1
+#define PIPELINE_STAGE_BIDI		2
+#define PIPELINE_STAGE_SCRIPT_SPLIT	3
+#define PIPELINE_STAGE_SHAPE		4
+#define PIPELINE_STAGE_RASTERIZE	5
+#define PIPELINE_STAGE_ATLAS_PACK	6
+//Whole Paragraph::SloveLayout, includes script split, shape, rasterize and atlas pack
+#define PIPELINE_STAGE_LAYOUT		7
+#define PIPELINE_STAGE_NUM		8
+
+struct StageStats {
+	uint64_t count = 0;
+	uint64_t total_ns = 0;
+	uint64_t last_edit_count = 0;
+	uint64_t last_edit_ns = 0;
+};
+
+
+//Counters of one TextEngine. "last_edit" fields cover the most recent
+//Append/Insert/Delete/Replace/SetWarpWidth call, the others are cumulative.
+struct PipelineStats {
+	StageStats stages[PIPELINE_STAGE_NUM];
+	uint64_t edits = 0;
+	uint64_t total_edit_ns = 0;
+	uint64_t last_edit_ns = 0;
+	uint64_t glyph_cache_hits = 0;
+	uint64_t glyph_cache_misses = 0;
+	uint64_t atlas_insertions = 0;
+	uint64_t shaped_codepoints = 0;
+
+	void Reset() {
+		*this = PipelineStats();
+	}
+};
+
+const char* PipelineStageName(int stage);
+uint64_t PipelineStatsNow();
+
+
+#ifdef TEXT_ENGINE_STATS
+
+//Stats of the edit running on this thread, null outside of an edit
+extern thread_local PipelineStats* current_pipeline_stats;
+
+class PipelineEditScope {
+	PipelineStats* prev;
+	uint64_t start;
+
+public:
+	PipelineEditScope(PipelineStats* stats);
+	~PipelineEditScope();
+};
+
+
+class PipelineStageTimer {
+	int stage;
+	uint64_t start;
+
+public:
+	PipelineStageTimer(int stage) :stage(stage), start(PipelineStatsNow()) {}
+	~PipelineStageTimer();
+};
+
+#define _STATS_CONCAT(a,b) a##b
+#define STATS_CONCAT(a,b) _STATS_CONCAT(a,b)
+#define STATS_EDIT_SCOPE(stats) PipelineEditScope STATS_CONCAT(_stats_edit_,__LINE__)(stats)
+#define STATS_STAGE(stage) PipelineStageTimer STATS_CONCAT(_stats_stage_,__LINE__)(stage)
+#define STATS_COUNT(field,n) {if(current_pipeline_stats!=nullptr) current_pipeline_stats->field+=(n);}
+
+#else
+
+#define STATS_EDIT_SCOPE(stats)
+#define STATS_STAGE(stage)
+#define STATS_COUNT(field,n)
+
+#endif
+
+#endif
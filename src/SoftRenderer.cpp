@@ -0,0 +1,149 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "SoftRenderer.h"
+
+
+void DrawBackground(
+	uint8_t* dst,
+	int dst_w, int dst_h,
+	int x, int y,
+	int w, int h,
+	uint32_t rgba
+) {
+	uint8_t r = (rgba >> 24) & 0xFFU;
+	uint8_t g = (rgba >> 16) & 0xFFU;
+	uint8_t b = (rgba >> 8) & 0xFFU;
+	float a = static_cast<float>((rgba >> 0) & 0xFFU) / 255;
+	for (int j = 0;j < h;++j) {
+		if (y + j >= dst_h || y + j < 0)
+			continue;
+		uint8_t* target = dst + (y + j) * dst_w * 4 + x * 4;
+		for (int i = 0;i < w;++i) {
+			if (x + i >= dst_w || x + i < 0)
+				continue;
+			uint8_t* p = target + i * 4;
+			p[0] = p[0] * (1 - a) + r * a;
+			p[1] = p[1] * (1 - a) + g * a;
+			p[2] = p[2] * (1 - a) + b * a;
+		}
+	}
+}
+
+
+void BlitGrayFont(
+	const uint8_t* font_atlas,
+	int x, int y,
+	int w, int h,
+	int atlas_w,
+	uint8_t* dst,
+	int dst_x, int dst_y,
+	int dst_w, int dst_h,
+	uint32_t rgba
+) {
+	uint8_t r = (rgba >> 24) & 0xFFU;
+	uint8_t g = (rgba >> 16) & 0xFFU;
+	uint8_t b = (rgba >> 8) & 0xFFU;
+	float a = static_cast<float>((rgba >> 0) & 0xFFU) / 255;
+
+	for (int j = 0;j < h;++j) {
+		if (dst_y + j >= dst_h || dst_y + j < 0)
+			continue;
+		uint8_t* target = dst + (dst_y + j) * dst_w * 4 + dst_x * 4;
+		const uint8_t* src = font_atlas + (y + j) * atlas_w + x;
+		for (int i = 0;i < w;++i) {
+			if (dst_x + i >= dst_w || dst_x + i < 0)
+				continue;
+			float c = static_cast<float>(*(src + i)) / 255;
+			c *= a;
+			uint8_t* p = target + i * 4;
+			p[0] = p[0] * (1 - c) + r * c;
+			p[1] = p[1] * (1 - c) + g * c;
+			p[2] = p[2] * (1 - c) + b * c;
+		}
+	}
+}
+
+
+size_t DrawText(
+	uint8_t* dst,
+	int dst_w, int dst_h,
+	FontCollection* ff,
+	TextEngine* te,
+	const CPPos& ipos,
+	const CPPos& spos,
+	float offset,
+	float ascent,
+	float lh,
+	bool is_ltr
+) {
+	float pen_x = 0;
+	float pen_y = ascent - offset;
+	size_t drawn = 0;
+
+	size_t paragraph_num = te->GetParagarphNum();
+	for (size_t i = 0;i < paragraph_num;++i) {
+		Paragraph* paragraph = te->GetParagraph(i);
+		size_t line_num = paragraph->lines.GetSize();
+		if (line_num == 0)
+			pen_y += lh;
+		for (size_t j = 0;j < line_num;++j) {
+			if (pen_y - ascent > dst_h)
+				return drawn;
+			//Scrolled out above, descenders stay within one line height of the baseline
+			if (pen_y + lh < 0) {
+				pen_y += lh;
+				continue;
+			}
+			TextLine* line = paragraph->lines.Get(j);
+			if (!is_ltr)
+				pen_x = dst_w - line->width;
+			for (auto it = line->glyphs.begin();it != line->glyphs.end();++it) {
+				size_t k = it.GetIndex();
+				const MappedGlyph& mg = *it;
+				AtlasRegion ar = ff->GetAtlasRegion(mg.gi);
+				float gx = pen_x + mg.gi.offset_x;
+				if (gx < dst_w && gx + ar.width >= 0) {
+					if (te->IsGlyphInRange({ i,j,k }, ipos, spos))
+						DrawBackground(
+							dst,
+							dst_w, dst_h,
+							pen_x, pen_y - ascent,
+							mg.gi.advance_x, lh
+						);
+					BlitGrayFont(
+						ff->GetAtlasBuffer(mg.gi, ar.face_index),
+						ar.x, ar.y,
+						ar.width, ar.height,
+						ff->GetAtlasSize(mg.gi),
+						dst,
+						pen_x + mg.gi.offset_x,
+						pen_y - mg.gi.offset_y,
+						dst_w, dst_h,
+						0xFFFFFFFF
+					);
+					++drawn;
+				}
+				pen_x += mg.gi.advance_x;
+			}
+			pen_x = 0;
+			pen_y += lh;
+		}
+	}
+	return drawn;
+}
+
+
+void DrawCursor(uint8_t* dst, int dst_w, int dst_h, float x, float y, float lh) {
+	if (x < 0 || x >= dst_w)
+		return;
+	for (int i = y;i < y + lh;++i) {
+		if (i >= 0 && i < dst_h) {
+			uint8_t* p = dst + (int)x * 4 + i * dst_w * 4;
+			p[0] = 255;
+			p[1] = 255;
+			p[2] = 255;
+			p[3] = 255;
+		}
+	}
+}
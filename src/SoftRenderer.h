@@ -0,0 +1,52 @@
+#ifndef SOFT_RENDERER_H
+#define SOFT_RENDERER_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include "FontCollection.h"
+#include "TextEngine.h"
+
+//Software compositor of the demo. Every target is a 4 bytes per pixel buffer
+//with a pitch of dst_w * 4, colors are 0xRRGGBBAA.
+
+void DrawBackground(
+	uint8_t* dst,
+	int dst_w, int dst_h,
+	int x, int y,
+	int w, int h,
+	uint32_t rgba = 0xFF0000FFU
+);
+
+void BlitGrayFont(
+	const uint8_t* font_atlas,
+	int x, int y,
+	int w, int h,
+	int atlas_w,
+	uint8_t* dst,
+	int dst_x, int dst_y,
+	int dst_w, int dst_h,
+	uint32_t rgba = 0xFFFFFFFFU
+);
+
+//Draws the lines visible after scrolling down by offset, highlighting the glyphs
+//between ipos and spos. ascent is the baseline of the first line, lh the line
+//height. Returns the number of glyphs blitted.
+size_t DrawText(
+	uint8_t* dst,
+	int dst_w, int dst_h,
+	FontCollection* ff,
+	TextEngine* te,
+	const CPPos& ipos,
+	const CPPos& spos,
+	float offset,
+	float ascent,
+	float lh,
+	bool is_ltr
+);
+
+void DrawCursor(uint8_t* dst, int dst_w, int dst_h, float x, float y, float lh);
+
+#endif
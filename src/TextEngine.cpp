@@ -8,7 +8,10 @@
 #include <hb-ft.h>
 #include <LineBreaker.h>
 #include "UTF8Codec.h"
-#include "List.h"
+#include "PipelineStats.h"
+#include "TraceRecorder.h"
+#include "MemoryStats.h"
+#include <cstring>
 
 
 ////////////
@@ -65,50 +68,76 @@ void TextLine::Append(uint32_t glyph_index, size_t map, uint32_t codepoint, bool
 /////////////
 //Paragraph//
 /////////////
-uint32_t CodepointAt(const void* cps, size_t index) {
-	return reinterpret_cast<const Array<CPInfo>*>(cps)->Get(index).codepoint;
+TextLine* Paragraph::_NewLine(size_t index) {
+	size_t sn = this->spare_lines.GetSize();
+	if (sn == 0)
+		return new TextLine(index);
+	TextLine* ret = this->spare_lines.Get(sn - 1);
+	this->spare_lines.Pop();
+	ret->index = index;
+	ret->width = 0;
+	ret->glyphs.Truncate(0);
+	return ret;
 }
 
 
 TextLine* Paragraph::_GetLastLine() {
 	if (this->lines.GetSize() == 0)
-		this->lines.Push(new TextLine(0));
+		this->lines.Push(this->_NewLine(0));
 	return this->lines.Get(this->lines.GetSize() - 1);
 }
 
 
 void Paragraph::_AppendNewLine() {
-	this->lines.Push(new TextLine(this->lines.GetSize()));
+	this->lines.Push(this->_NewLine(this->lines.GetSize()));
+}
+
+
+//Lines a layout did not take back are freed past INLINE_LINE_NUM, so a
+//paragraph that once wrapped into many lines does not keep them
+void Paragraph::_TrimSpareLines() {
+	for (size_t i = this->spare_lines.GetSize();i > INLINE_LINE_NUM;--i) {
+		delete this->spare_lines.Get(i - 1);
+		this->spare_lines.Pop();
+	}
+	//Room for the lines the next ClearLines hands over
+	if (this->spare_lines.GetCapacity() > this->lines.GetCapacity())
+		this->spare_lines.SetCapacity(this->lines.GetCapacity());
 }
 
 
-Paragraph::Paragraph(FontCollection* ff, float warp_width) :ff(ff), warp_width(warp_width) {}
+Paragraph::Paragraph(FontCollection* ff, float warp_width) :
+	spare_lines(128, MEMORY_HOOKS(MEMORY_CATEGORY_LINES)),
+	warp_width(warp_width), 
+	ff(ff), 
+	cps(MEMORY_HOOKS(MEMORY_CATEGORY_CODEPOINTS)), 
+	lines(128, MEMORY_HOOKS(MEMORY_CATEGORY_LINES)) {}
 
 
-void Paragraph::Insert(size_t pos, const Array<CPInfo>& cps, size_t start, size_t len) {
-	if (len == 0)
+void Paragraph::Insert(size_t pos, const CodepointArray& cps, size_t start, size_t len) {
+	this->cps.InsertRange(pos, cps, start, len);
+}
+
+
+void Paragraph::ReleaseBidi() {
+	if (this->sba == nullptr)
 		return;
-	size_t old_size = this->cps.GetSize();
-	if (this->cps.GetSize() > 0)
-		for (size_t i = this->cps.GetSize() - 1;i >= pos;--i)
-			this->cps.Set(i + len, this->cps.Get(i));
-	for (size_t i = 0;i < len;++i)
-		this->cps.Set(pos + i, cps.Get(start + i));
+	SBLineRelease(this->sbl);
+	SBParagraphRelease(this->sbp);
+	SBAlgorithmRelease(this->sba);
+	this->sbl = nullptr;
+	this->sbp = nullptr;
+	this->sba = nullptr;
+	this->sbpl = 0;
 }
 
 
 void Paragraph::SloveBidi() {
-	if (this->sba != nullptr) {
-		SBLineRelease(this->sbl);
-		SBParagraphRelease(this->sbp);
-		SBAlgorithmRelease(this->sba);
-		this->sbl = nullptr;
-		this->sbp = nullptr;
-		this->sba = nullptr;
-		this->sbpl = 0;
-	}
+	STATS_STAGE(PIPELINE_STAGE_BIDI);
+	this->ReleaseBidi();
 	if (this->cps.GetSize() > 0) {
-		SBCodepointSequence sbs = { CodepointAt,&this->cps,this->cps.GetSize() };
+		//Only read while the objects are created, an edit solves them again
+		SBCodepointSequence sbs = { nullptr,this->cps.GetCodepointBuffer(),this->cps.GetSize() };
 		this->sba = SBAlgorithmCreate(&sbs);
 		this->sbp = SBAlgorithmCreateParagraph(sba, 0, INT32_MAX, SBLevelDefaultLTR);
 		this->sbpl = SBParagraphGetLength(sbp);
@@ -117,6 +146,11 @@ void Paragraph::SloveBidi() {
 }
 
 
+//Segments of a bidi run kept inline, longer runs spill into the edit's arena
+#define INLINE_SEGMENT_NUM	16
+#define SEGMENT_BLOCK_SIZE	128
+
+
 struct TextSegment {
 	size_t index;
 	size_t start;
@@ -134,9 +168,12 @@ struct TextSegment {
 };
 
 
+typedef Array<TextSegment, INLINE_SEGMENT_NUM> TextSegments;
+
+
 void AppendNewSegment(
-	List<TextSegment>& segments,
-	Array<CPInfo>& cps,
+	TextSegments& segments,
+	const CodepointArray& cps,
 	size_t start, size_t len, size_t script_start,
 	hb_script_t script,
 	FontCollection* ff
@@ -145,21 +182,21 @@ void AppendNewSegment(
 	if (len > 0) {
 		font = ff->GetFirstFont();
 		while (font != nullptr) {
-			if (font->GetGlyphIndex(cps.Get(start + script_start).codepoint) != 0)
+			if (font->GetGlyphIndex(cps.GetCodepoint(start + script_start)) != 0)
 				break;
 			font = font->Next();
 		}
 	}
 
-	segments.PushBack(TextSegment(segments.GetSize(), start, len, script, font));
+	segments.Emplace(segments.GetSize(), start, len, script, font);
 }
 
 
 void SplitByScript(
-	Array<CPInfo>& cps, 
+	const CodepointArray& cps, 
 	size_t start, 
 	size_t len, 
-	List<TextSegment>& segments, 
+	TextSegments& segments, 
 	FontCollection* ff
 ) {
 	hb_script_t curr_script = HB_SCRIPT_COMMON;
@@ -167,7 +204,7 @@ void SplitByScript(
 	size_t last = start;
 	size_t script_start = 0;
 	for (size_t i = 0;i < len;++i) {
-		uint32_t cp = cps.Get(start + i).codepoint;
+		uint32_t cp = cps.GetCodepoint(start + i);
 		if (i == 0) {
 			curr_script = hb_unicode_script(hb_unicode_funcs_get_default(), cp);
 			curr_is_digit = (cp >= 0x30 && cp <= 0x39);
@@ -182,11 +219,13 @@ void SplitByScript(
 		if ((curr_script == HB_SCRIPT_COMMON || curr_script == HB_SCRIPT_INHERITED) && !curr_is_digit) {
 			curr_script = script;
 			curr_is_digit = is_digit;
-			script_start = i;
+			//Relative to the segment, its font is picked by this codepoint
+			script_start = start + i - last;
 			continue;
 		}
 		AppendNewSegment(segments, cps, last, start + i - last, script_start, curr_script, ff);
 		last = start + i;
+		script_start = 0;
 		curr_script = script;
 		curr_is_digit = is_digit;
 	}
@@ -194,26 +233,28 @@ void SplitByScript(
 }
 
 
-void ReverseMap(const Array<MappedGlyph>& mapped, Array<CPInfo>& cps, size_t begin, size_t line_index, bool is_ltr) {
+void ReverseMap(const Array<MappedGlyph>& mapped, CodepointArray& cps, size_t begin, size_t line_index, bool is_ltr) {
 	size_t gn = mapped.GetSize();
-	if (gn == 0)
+	//Nothing was appended after begin
+	if (begin >= gn)
 		return;
-	size_t cluster;
-	size_t start;
+	size_t cluster = 0;
+	size_t start = begin;
 	for (size_t i = begin;i <= gn;++i) {
 		if (i == begin) {
-			cluster = mapped.Get(i).map;
+			cluster = mapped.GetUnchecked(i).map;
 			start = i;
 		}
-		else if (i == gn || mapped.Get(i).map != cluster) {
-			CPInfo& cpi = cps.Get(cluster);
-			CP_FLAG_SET(cpi.flags, CP_FLAG_IS_RTL, !is_ltr);
-			CP_FLAG_SET(cpi.flags, CP_FLAG_MAPPED, true);
-			cpi.line = line_index;
-			cpi.start = start;
-			cpi.len = i - start;
+		else if (i == gn || mapped.GetUnchecked(i).map != cluster) {
+			uint8_t& flags = cps.GetFlagsUnchecked(cluster);
+			CP_FLAG_SET(flags, CP_FLAG_IS_RTL, !is_ltr);
+			CP_FLAG_SET(flags, CP_FLAG_MAPPED, true);
+			CPMap& map = cps.GetMapUnchecked(cluster);
+			map.line = static_cast<uint32_t>(line_index);
+			map.start = static_cast<uint32_t>(start);
+			map.len = static_cast<uint32_t>(i - start);
 			if (i < gn) {
-				cluster = mapped.Get(i).map;
+				cluster = mapped.GetUnchecked(i).map;
 				start = i;
 			}
 		}
@@ -222,11 +263,18 @@ void ReverseMap(const Array<MappedGlyph>& mapped, Array<CPInfo>& cps, size_t beg
 
 
 void Paragraph::SloveLayout() {
-	for (size_t i = 0;i < cps.GetSize();++i)
-		CP_FLAG_SET(cps.Get(i).flags,CP_FLAG_MAPPED,false);
+	STATS_STAGE(PIPELINE_STAGE_LAYOUT);
+	uint8_t* flags = this->cps.GetFlagBuffer();
+	for (size_t i = 0;i < this->cps.GetSize();++i)
+		CP_FLAG_SET(flags[i], CP_FLAG_MAPPED, false);
 	this->ClearLines();
-	if (this->sba == nullptr)
+	//Released over the library limit, solved again for this layout
+	if (this->sba == nullptr && this->cps.GetSize() > 0)
+		this->SloveBidi();
+	if (this->sba == nullptr) {
+		this->_TrimSpareLines();
 		return;
+	}
 	float line_width = 0;
 	GlyphInfo gi;
 	float real_adv;
@@ -236,38 +284,49 @@ void Paragraph::SloveLayout() {
 		float max_adv = this->ff->GetMaxAdvance();
 		for (SBUInteger i = 0; i < run_num; i++) {
 			bool is_ltr = runs[i].level % 2 == 0;
-			List<TextSegment> segments;
+			MEMORY_ARENA_MARK();
+			TextSegments segments(SEGMENT_BLOCK_SIZE, MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
 			//Split text into segment with same direction and script
-			SplitByScript(this->cps, runs[i].offset, runs[i].length, segments, this->ff);
+			{
+				STATS_STAGE(PIPELINE_STAGE_SCRIPT_SPLIT);
+				SplitByScript(this->cps, runs[i].offset, runs[i].length, segments, this->ff);
+			}
 			bool next;
-			for (auto j = segments.GetFront();!j.IsNull();j.Next()) {
+			for (size_t j = 0;j < segments.GetSize();++j) {
 				next = true;
-				TextSegment& segment = j.Data();
+				TextSegment& segment = segments.GetUnchecked(j);
 				if (segment.font == nullptr) {
 					for (size_t x = segment.start;x < segment.len;++x) {
 						if (this->warp_width > 0 && line_width + max_adv > warp_width)
 							this->_AppendNewLine();
-						this->_GetLastLine()->Append(0, x, this->cps.Get(x).codepoint, is_ltr, nullptr, ff);
+						this->_GetLastLine()->Append(0, x, this->cps.GetCodepoint(x), is_ltr, nullptr, ff);
 					}
 				}
 				else {
 					size_t lb = 0;
-					hb_buffer_t* hb_buffer = hb_buffer_create();
-					hb_buffer_set_content_type(hb_buffer, HB_BUFFER_CONTENT_TYPE_UNICODE);
-					for (size_t k = 0;k < segment.len; ++k)
-						hb_buffer_add(hb_buffer, this->cps.Get(segment.start + k).codepoint, segment.start + k);
-					hb_buffer_set_script(hb_buffer, segment.script);
-					hb_buffer_guess_segment_properties(hb_buffer);
+					hb_buffer_t* hb_buffer;
 					uint32_t gn;
-					hb_shape(segment.font->GetHBFont(), hb_buffer, NULL, 0);
+					{
+						STATS_STAGE(PIPELINE_STAGE_SHAPE);
+						TRACE_SPAN("hb_shape", TRACE_NO_ARG, segment.len);
+						hb_buffer = this->ff->GetShapeBuffer();
+						hb_buffer_set_content_type(hb_buffer, HB_BUFFER_CONTENT_TYPE_UNICODE);
+						const uint32_t* codepoints = this->cps.GetCodepointBuffer();
+						for (size_t k = segment.start;k < segment.start + segment.len;++k)
+							hb_buffer_add(hb_buffer, codepoints[k], k);
+						hb_buffer_set_script(hb_buffer, segment.script);
+						hb_buffer_guess_segment_properties(hb_buffer);
+						hb_shape(segment.font->GetHBFont(), hb_buffer, NULL, 0);
+						STATS_COUNT(shaped_codepoints, segment.len);
+					}
 					hb_glyph_info_t* gis = hb_buffer_get_glyph_infos(hb_buffer, &gn);
 					hb_glyph_position_t* gps = hb_buffer_get_glyph_positions(hb_buffer, &gn);
 					size_t k = 0;
 					float segment_width = 0;
 					TextLine* last_line;
-					auto temp = j;
-					temp.Next();
-					bool incomplete = (!temp.IsNull() && j.Data().index == temp.Data().index);
+					//Rest of a split segment, moved past the break when this one wraps
+					TextSegment* rest = j + 1 < segments.GetSize() ? &segments.GetUnchecked(j + 1) : nullptr;
+					bool incomplete = (rest != nullptr && segment.index == rest->index);
 					bool skip = false;
 					while (k < gn && !skip) {
 						if (!FetchGlyph(gis[is_ltr ? k : gn - 1 - k].codepoint, segment.font, gi, ff))
@@ -282,11 +341,11 @@ void Paragraph::SloveLayout() {
 						if (
 							this->warp_width > 0 
 							&& line_width + segment_width + real_adv >= this->warp_width 
-							&& this->cps.Get(gis[is_ltr ? k : gn - 1 - k].cluster).codepoint != ' '
+							&& this->cps.GetCodepointUnchecked(gis[is_ltr ? k : gn - 1 - k].cluster) != ' '
 							) {
 							size_t bk = k;
 							while (bk > lb) {
-								if (CP_FLAG_GET(this->cps.Get(gis[is_ltr ? bk : gn - 1 - bk].cluster).flags,CP_FLAG_CAN_BREAK))
+								if (CP_FLAG_GET(this->cps.GetFlagsUnchecked(gis[is_ltr ? bk : gn - 1 - bk].cluster),CP_FLAG_CAN_BREAK))
 									break;
 								--bk;
 							}
@@ -302,23 +361,23 @@ void Paragraph::SloveLayout() {
 										//Split segment
 										size_t lb_unmap = gis[is_ltr ? lb : gn - 1 - lb].cluster;
 										size_t k_unmap = gis[is_ltr ? k : gn - 1 - k].cluster;
-										auto temp = j;
-										temp.Next();
-										if (!temp.IsNull() && j.Data().index == temp.Data().index) {
-											temp.Data().len = temp.Data().start + temp.Data().len - k_unmap;
-											temp.Data().start = k_unmap;
+										if (incomplete) {
+											rest->len = rest->start + rest->len - k_unmap;
+											rest->start = k_unmap;
 										}
 										else {
-											segments.InsertAfter(j, {
+											//Inserting may move the segments, segment is not used after it
+											segments.Insert(j + 1, TextSegment(
 												segment.index,
 												k_unmap,
 												segment.len - (k_unmap - segment.start),
 												segment.script,
 												segment.font
-												});
+											));
 										}
-										segment.len = k_unmap - lb_unmap;
-										segment.start = lb_unmap;
+										TextSegment& head = segments.GetUnchecked(j);
+										head.len = k_unmap - lb_unmap;
+										head.start = lb_unmap;
 										skip = true;
 										next = false;
 										continue;
@@ -327,8 +386,8 @@ void Paragraph::SloveLayout() {
 										bk = k;
 										if (incomplete) {
 											size_t bk_unmap = bk < gn ? gis[is_ltr ? bk : gn - 1 - bk].cluster : segment.start + segment.len;
-											temp.Data().len = temp.Data().start + temp.Data().len - bk_unmap;
-											temp.Data().start = bk_unmap;
+											rest->len = rest->start + rest->len - bk_unmap;
+											rest->start = bk_unmap;
 											skip = true;
 										}
 									}
@@ -344,15 +403,15 @@ void Paragraph::SloveLayout() {
 							}
 							else if (incomplete) {
 								size_t bk_unmap= gis[is_ltr ? bk : gn - 1 - bk].cluster;
-								temp.Data().len = temp.Data().start + temp.Data().len - bk_unmap;
-								temp.Data().start = bk_unmap;
+								rest->len = rest->start + rest->len - bk_unmap;
+								rest->start = bk_unmap;
 								skip = true;
 							}
 
 							//Append to last line
 							size_t begin = last_line->glyphs.GetSize();
 							for (size_t x = is_ltr ? lb : gn - bk; x <(is_ltr ? bk : gn-lb); ++x)
-								last_line->Append(gis[x].codepoint, gis[x].cluster, this->cps.Get(gis[x].cluster).codepoint, is_ltr, segment.font, this->ff);
+								last_line->Append(gis[x].codepoint, gis[x].cluster, this->cps.GetCodepointUnchecked(gis[x].cluster), is_ltr, segment.font, this->ff);
 							ReverseMap(last_line->glyphs, this->cps, begin, last_line->index, is_ltr);
 							k = bk;
 							lb = k;
@@ -369,7 +428,7 @@ void Paragraph::SloveLayout() {
 						last_line = this->_GetLastLine();
 						size_t begin = last_line->glyphs.GetSize();
 						for (size_t x = is_ltr ? lb : gn - k;x < (is_ltr ? k : gn - lb); ++x)
-							last_line->Append(gis[x].codepoint, gis[x].cluster, this->cps.Get(gis[x].cluster).codepoint, is_ltr, segment.font, this->ff);
+							last_line->Append(gis[x].codepoint, gis[x].cluster, this->cps.GetCodepointUnchecked(gis[x].cluster), is_ltr, segment.font, this->ff);
 						ReverseMap(last_line->glyphs, this->cps, begin, last_line->index, is_ltr);
 						line_width += segment_width;
 						if (incomplete) {
@@ -377,19 +436,22 @@ void Paragraph::SloveLayout() {
 							line_width = 0;
 						}
 					}
-					hb_buffer_destroy(hb_buffer);
 				}
 			}
 		}
 	}
+	this->_TrimSpareLines();
+	//Over the engine's library limit, the next layout solves bidi again
+	if (current_memory_account != nullptr && current_memory_account->IsOverLimit(MEMORY_CATEGORY_BIDI))
+		this->ReleaseBidi();
 }
 
 
 void Paragraph::ClearLines() {
-	for (size_t i = 0;i < this->lines.GetSize();++i) {
-		delete this->lines.Get(i);
-	}
-	this->lines.Clear();
+	//Pushed last line first, so relayout hands every line its own glyph blocks back
+	for (size_t i = this->lines.GetSize();i > 0;--i)
+		this->spare_lines.Push(this->lines.Get(i - 1));
+	this->lines.Truncate(0);
 }
 
 
@@ -397,6 +459,8 @@ Paragraph::~Paragraph() {
 	this->cps.Clear();
 	this->SloveBidi();
 	this->ClearLines();
+	for (size_t i = 0;i < this->spare_lines.GetSize();++i)
+		delete this->spare_lines.Get(i);
 }
 
 
@@ -405,73 +469,185 @@ Paragraph::~Paragraph() {
 //////////////
 Paragraph* TextEngine::_GetLastParagraph() {
 	if (this->paragraphs.GetSize() == 0)
-		this->paragraphs.Push(new Paragraph(this->ff, this->warp_width));
+		this->_PushParagraph();
 	return this->paragraphs.Get(this->paragraphs.GetSize() - 1);
 }
 
 
-void TextEngine::_DecodeUtf8(const char* utf8_str, size_t len, Array<CPInfo>& cps) {
+void TextEngine::_PushParagraph() {
+	this->paragraphs.Push(new Paragraph(this->ff, this->warp_width));
+	this->index.Insert(this->index.GetSize(), 1);
+}
+
+
+//Separators that end a paragraph by themselves. A newline ending one is only
+//kept after another separator, see ParagraphTextEnd
+bool IsParagraphSeparator(uint32_t codepoint) {
+	return codepoint == '\n' || codepoint == 0x0b || codepoint == 0x0c || codepoint == '\r' || codepoint == 0x85 || codepoint == 0x2028 || codepoint == 0x2029;
+}
+
+
+//False if a newline is exported after the paragraph
+bool EndsWithSeparator(const CodepointArray& cps) {
+	size_t cp_num = cps.GetSize();
+	return cp_num > 0 && IsParagraphSeparator(cps.GetCodepointUnchecked(cp_num - 1));
+}
+
+
+//End of the paragraph text in [begin, end) of cps, prev is the codepoint before
+//begin. A closing newline is dropped and exported after the paragraph. One
+//after another separator stays, so a lone CR and a CRLF both export as they came.
+size_t ParagraphTextEnd(const CodepointArray& cps, size_t begin, size_t end, uint32_t prev) {
+	if (end == begin || cps.GetCodepoint(end - 1) != '\n')
+		return end;
+	uint32_t before = end - 1 > begin ? cps.GetCodepoint(end - 2) : prev;
+	return IsParagraphSeparator(before) ? end : end - 1;
+}
+
+
+void TextEngine::_IndexParagraph(size_t index) {
+	const CodepointArray& cps = this->paragraphs.Get(index)->cps;
+	ParagraphExtent extent;
+	extent.cps = cps.GetSize();
+	extent.bytes = UTF8EncodedLength(cps.GetCodepointBuffer(), extent.cps);
+	if (EndsWithSeparator(cps))
+		extent.newline = 0;
+	this->index.Set(index, extent);
+}
+
+
+//Codepoints made room for at a time, a chunk of input never decodes to more
+#define UTF8_DECODE_CHUNK	4096
+
+
+//Decoded straight into the codepoint buffer of cps, the room left over is
+//given back after each chunk
+void TextEngine::_DecodeUtf8(const char* utf8_str, size_t len, CodepointArray& cps) {
+	STATS_STAGE(PIPELINE_STAGE_UTF8_DECODE);
+	const unsigned char* str = reinterpret_cast<const unsigned char*>(utf8_str);
 	size_t i = 0;
 	while (i < len) {
-		uint32_t code;
-		int nb = UTF8Decode((const unsigned char*)utf8_str, i, len, code);
-		if (nb > 0) {
-			cps.Push(CPInfo(code));
-			i += nb;
-		}
-		else
-			++i;
+		size_t size = cps.GetSize();
+		size_t room = len - i < UTF8_DECODE_CHUNK ? len - i : UTF8_DECODE_CHUNK;
+		size_t consumed;
+		size_t n = UTF8DecodeRange(str + i, len - i, cps.AppendCodepoints(room), room, consumed);
+		cps.Truncate(size + n);
+		i += consumed;
 	}
 }
 
 
+void TextEngine::_DecodeUtf16(const uint16_t* utf16_str, size_t len, CodepointArray& cps) {
+	STATS_STAGE(PIPELINE_STAGE_UTF8_DECODE);
+	size_t i = 0;
+	while (i < len) {
+		size_t size = cps.GetSize();
+		size_t room = len - i < UTF8_DECODE_CHUNK ? len - i : UTF8_DECODE_CHUNK;
+		size_t consumed;
+		size_t n = UTF16DecodeRange(utf16_str + i, len - i, cps.AppendCodepoints(room), room, consumed);
+		cps.Truncate(size + n);
+		i += consumed;
+	}
+}
+
+
+//One codepoint per unit
+void TextEngine::_DecodeUtf32(const uint32_t* utf32_str, size_t len, CodepointArray& cps) {
+	STATS_STAGE(PIPELINE_STAGE_UTF8_DECODE);
+	uint32_t* codepoints = cps.AppendCodepoints(len);
+	for (size_t i = 0;i < len;++i)
+		codepoints[i] = UTF32Sanitize(utf32_str[i]);
+}
+
+
 void TextEngine::_DeleteParagraphs(size_t start, size_t len) {
 	if (len > 0) {
 		for (size_t j = 0;j < len;++j)
 			delete this->paragraphs.Get(start + j);
-		size_t old_size = this->paragraphs.GetSize();
-		for (size_t j = start + len;j < old_size;++j)
-			this->paragraphs.Set(j - len, this->paragraphs.Get(j));
-		this->paragraphs.SetCapacity(old_size - len);
+		this->paragraphs.RemoveRange(start, len);
+		this->index.Remove(start, len);
 	}
 }
 
 
-void SloveLineBreak(Array<CPInfo>& cps) {
+//Drops the codepoints past size but keeps one spare block, so typing back and
+//forth across a block edge stays off the heap
+void TruncateCodepoints(CodepointArray& cps, size_t size) {
+	cps.Truncate(size);
+	if (cps.GetCapacity() > size * 2 + CP_BLOCK_SIZE)
+		cps.SetCapacity(size + CP_BLOCK_SIZE);
+}
+
+
+//Gives back the room doubling left once a paragraph is complete, keeping the
+//spare codepoints TruncateCodepoints does
+void FitCodepoints(CodepointArray& cps) {
+	size_t size = cps.GetSize();
+	if (cps.GetCapacity() > size + CP_BLOCK_SIZE)
+		cps.SetCapacity(size + CP_BLOCK_SIZE);
+}
+
+
+bool NextLineBreak(LineBreaker& lb, LineBreaker::Break& br) {
+	STATS_STAGE(PIPELINE_STAGE_LINE_BREAK);
+	return lb.NextBreak(br);
+}
+
+
+void SloveLineBreak(CodepointArray& cps) {
+	STATS_STAGE(PIPELINE_STAGE_LINE_BREAK);
 	size_t cp_num = cps.GetSize();
 	if (cp_num == 0)
 		return;
+	uint8_t* flags = cps.GetFlagBuffer();
 	for (size_t i = 0;i < cp_num;++i)
-		CP_FLAG_SET(cps.Get(i).flags, CP_FLAG_CAN_BREAK, false);
-	LineBreaker lb(&cps, cp_num, CodepointAt);
+		CP_FLAG_SET(flags[i], CP_FLAG_CAN_BREAK, false);
+	LineBreaker lb(cps.GetCodepointBuffer(), cp_num, nullptr);
 	LineBreaker::Break br;
 	while (lb.NextBreak(br))
 		if (br.position < cp_num)
-			CP_FLAG_SET(cps.Get(br.position).flags, CP_FLAG_CAN_BREAK, true);
+			CP_FLAG_SET(flags[br.position], CP_FLAG_CAN_BREAK, true);
+}
+
+
+void RelayoutParagraph(Paragraph* paragraph, size_t index, bool line_break) {
+	TRACE_SPAN("Paragraph::Relayout", index, paragraph->cps.GetSize());
+#ifndef TEXT_ENGINE_TRACE
+	(void)index;
+#endif
+	if (line_break)
+		SloveLineBreak(paragraph->cps);
+	paragraph->SloveBidi();
+	paragraph->SloveLayout();
+	paragraph->laid_out = paragraph->cps.GetSize();
 }
 
 
-void TextEngine::_Append(const Array<CPInfo>& cps) {
+void TextEngine::_Append(const CodepointArray& cps) {
 	size_t cp_num = cps.GetSize();
-	LineBreaker lb(reinterpret_cast<const void*>(&cps), cp_num, CodepointAt);
+	LineBreaker lb(cps.GetCodepointBuffer(), cp_num, nullptr);
 	LineBreaker::Break br;
 	size_t begin = 0;
-	while (lb.NextBreak(br)) {
+	while (NextLineBreak(lb, br)) {
 		if (br.position < cp_num)
-			CP_FLAG_SET(cps.Get(br.position).flags, CP_FLAG_CAN_BREAK, true);
+			CP_FLAG_SET(cps.GetFlags(br.position), CP_FLAG_CAN_BREAK, true);
 		if (br.required || br.position == cp_num) {
-			bool temp = cps.Get(cp_num - 1).codepoint == '\n';
+			bool temp = cps.GetCodepoint(cp_num - 1) == '\n';
 			Paragraph* last = this->_GetLastParagraph();
 			bool lb_reslove = last->cps.GetSize() > 0;
-			for (size_t i = begin;i < br.position;++i)
-				if (cps.Get(i).codepoint != '\n')
-					last->cps.Push(cps.Get(i));
-			if (lb_reslove)
-				SloveLineBreak(last->cps);
-			last->SloveBidi();
-			last->SloveLayout();
-			if((br.position == cp_num && cps.Get(cp_num - 1).codepoint == '\n') || br.required)
-				this->paragraphs.Push(new Paragraph(this->ff, this->warp_width));
+			//A newline can only end the range, it is a required break
+			size_t last_num = last->cps.GetSize();
+			size_t end = ParagraphTextEnd(cps, begin, br.position, last_num > 0 ? last->cps.GetCodepoint(last_num - 1) : 0);
+			//A new paragraph gets its text at the size it is, appends to it double
+			if (!lb_reslove && last->cps.GetCapacity() < end - begin)
+				last->cps.SetCapacity(end - begin);
+			last->cps.AppendRange(cps, begin, end - begin);
+			RelayoutParagraph(last, this->paragraphs.GetSize() - 1, lb_reslove);
+			this->_IndexParagraph(this->paragraphs.GetSize() - 1);
+			if ((br.position == cp_num && cps.GetCodepoint(cp_num - 1) == '\n') || br.required) {
+				FitCodepoints(last->cps);
+				this->_PushParagraph();
+			}
 			begin = br.position;
 		}
 	}
@@ -483,8 +659,8 @@ void TextEngine::_Append(const Array<CPInfo>& cps) {
 #define LINE_NUM(p) this->paragraphs.Get(p)->lines.GetSize()
 #define GLYPH_NUM(p,l) this->paragraphs.Get(p)->lines.Get(l)->glyphs.GetSize()
 #define CP_NUM(p) this->paragraphs.Get(p)->cps.GetSize()
-#define CP(p,i) this->paragraphs.Get(p)->cps.Get(i)
-#define SET_CP(p,i,v) this->paragraphs.Get(p)->cps.Set(i,v)
+#define CP_FLAGS(p,i) this->paragraphs.Get(p)->cps.GetFlags(i)
+#define CP_MAP(p,i) this->paragraphs.Get(p)->cps.GetMap(i)
 #define LINE(p,l) this->paragraphs.Get(p)->lines.Get(l)
 #define GLYPH(p,l,g) this->paragraphs.Get(p)->lines.Get(l)->glyphs.Get(g)
 #define UINT_DECREASE(exp) (exp>0?exp-1:0)
@@ -541,15 +717,15 @@ bool TextEngine::_CPPos2GPos(const CPPos& cpp, GlyphPos& gp) {
 	if (PARAGRAPH_NUM == 0)
 		return false;
 	if (cpp.cp < CP_NUM(cpp.paragraph)) {
-		if (!CP_FLAG_GET(CP(cpp.paragraph, cpp.cp).flags, CP_FLAG_MAPPED))
+		if (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, cpp.cp), CP_FLAG_MAPPED))
 			return false;
 		gp.after = false;
 		gp.paragraph = cpp.paragraph;
-		gp.line = CP(cpp.paragraph, cpp.cp).line;
-		gp.glyph = CP(cpp.paragraph, cpp.cp).start;
-		if (!CP_FLAG_GET(CP(cpp.paragraph, cpp.cp).flags,CP_FLAG_IS_RTL)) {
+		gp.line = CP_MAP(cpp.paragraph, cpp.cp).line;
+		gp.glyph = CP_MAP(cpp.paragraph, cpp.cp).start;
+		if (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, cpp.cp),CP_FLAG_IS_RTL)) {
 			if (cpp.eol) {
-				gp.glyph += UINT_DECREASE(CP(cpp.paragraph, cpp.cp).len);
+				gp.glyph += UINT_DECREASE(CP_MAP(cpp.paragraph, cpp.cp).len);
 				gp.after = true;
 			}
 		}
@@ -558,13 +734,13 @@ bool TextEngine::_CPPos2GPos(const CPPos& cpp, GlyphPos& gp) {
 			if (!cpp.eol) {
 				if (
 					pre.paragraph == cpp.paragraph
-					&& CP(pre.paragraph, pre.cp).line == CP(cpp.paragraph, cpp.cp).line
+					&& CP_MAP(pre.paragraph, pre.cp).line == CP_MAP(cpp.paragraph, cpp.cp).line
 					&& pre.cp != cpp.cp
-					&& !CP_FLAG_GET(CP(pre.paragraph, pre.cp).flags, CP_FLAG_IS_RTL)
+					&& !CP_FLAG_GET(CP_FLAGS(pre.paragraph, pre.cp), CP_FLAG_IS_RTL)
 					)
-					gp.glyph = CP(pre.paragraph, pre.cp).start + UINT_DECREASE(CP(pre.paragraph, pre.cp).len);
+					gp.glyph = CP_MAP(pre.paragraph, pre.cp).start + UINT_DECREASE(CP_MAP(pre.paragraph, pre.cp).len);
 				else
-					gp.glyph+= UINT_DECREASE(CP(cpp.paragraph, cpp.cp).len);
+					gp.glyph+= UINT_DECREASE(CP_MAP(cpp.paragraph, cpp.cp).len);
 				gp.after = true;
 			}
 		}
@@ -576,13 +752,13 @@ bool TextEngine::_CPPos2GPos(const CPPos& cpp, GlyphPos& gp) {
 		gp.after = false;
 		if (CP_NUM(cpp.paragraph) > 0) {
 			size_t pre = cpp.cp - 1;
-			while (!CP_FLAG_GET(CP(cpp.paragraph, pre).flags, CP_FLAG_MAPPED) && pre > 0)
+			while (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, pre), CP_FLAG_MAPPED) && pre > 0)
 				--pre;
-			if (CP_FLAG_GET(CP(cpp.paragraph, pre).flags,CP_FLAG_MAPPED)) {
-				gp.line = CP(cpp.paragraph, pre).line;
-				gp.glyph = CP(cpp.paragraph, pre).start;
-				if (!CP_FLAG_GET(CP(cpp.paragraph, pre).flags, CP_FLAG_IS_RTL)) {
-					gp.glyph += UINT_DECREASE(CP(cpp.paragraph, pre).len);
+			if (CP_FLAG_GET(CP_FLAGS(cpp.paragraph, pre),CP_FLAG_MAPPED)) {
+				gp.line = CP_MAP(cpp.paragraph, pre).line;
+				gp.glyph = CP_MAP(cpp.paragraph, pre).start;
+				if (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, pre), CP_FLAG_IS_RTL)) {
+					gp.glyph += UINT_DECREASE(CP_MAP(cpp.paragraph, pre).len);
 					gp.after = true;
 				}
 			}
@@ -639,7 +815,7 @@ CPPos TextEngine::_PreNextMappedCP(const CPPos& cpp, bool is_next) {
 		if (ret == old)
 			break;
 		if (ret.cp < CP_NUM(ret.paragraph)) {
-			if (CP_FLAG_GET(CP(ret.paragraph, ret.cp).flags, CP_FLAG_MAPPED))
+			if (CP_FLAG_GET(CP_FLAGS(ret.paragraph, ret.cp), CP_FLAG_MAPPED))
 				break;
 		}
 		else
@@ -690,18 +866,49 @@ float TextEngine::_ComputeCursorPosX(const GlyphPos& gp) {
 		g_max = g_max > GLYPH_NUM(gp.paragraph, gp.line) ? GLYPH_NUM(gp.paragraph, gp.line) : g_max;
 	else
 		g_max = 0;
-	for (size_t i = 0;i < g_max;++i)
-		x += GLYPH(gp.paragraph, gp.line, i).gi.advance_x;
+	if (g_max == 0)
+		return x;
+	this->paragraphs.Get(gp.paragraph)->lines.Get(gp.line)->glyphs.ForEachSpan(0, g_max, [&](MappedGlyph* span, size_t n) {
+		for (size_t i = 0;i < n;++i)
+			x += span[i].gi.advance_x;
+	});
 	return x;
 }
 
 
-TextEngine::TextEngine(FontCollection* ff, float warp_width):ff(ff),warp_width(warp_width){}
+//Public calls run inside the engine's stats, trace and memory scopes
+#define TEXT_ENGINE_SCOPE(name) \
+	STATS_EDIT_SCOPE(&this->stats); \
+	TRACE_EDIT_SCOPE(this->trace); \
+	MEMORY_SCOPE(&this->memory); \
+	MEMORY_ARENA_SCOPE(&this->arena); \
+	TRACE_SPAN(name)
+
+//Edits also start a new generation, TextAppender bumps it on its own
+#define TEXT_ENGINE_EDIT(name) \
+	++this->generation; \
+	TEXT_ENGINE_SCOPE(name)
+
+
+TextEngine::TextEngine(FontCollection* ff, float warp_width):
+	ff(ff),
+	warp_width(warp_width),
+	paragraphs(128, MEMORY_HOOKS(MEMORY_CATEGORY_PARAGRAPHS)) {
+	MemoryInstallBidiAllocator();
+	this->memory.SetPool(&this->pool);
+}
+
+
+TextEngine::~TextEngine() {
+	this->Clear();
+}
 
 
 void TextEngine::SetWarpWidth(float width) {
-	this->warp_width = warp_width;
+	TEXT_ENGINE_EDIT("TextEngine::SetWarpWidth");
+	this->warp_width = width;
 	for (size_t i = 0;i < this->paragraphs.GetSize();++i) {
+		TRACE_SPAN("Paragraph::SloveLayout", i, paragraphs.Get(i)->cps.GetSize());
 		paragraphs.Get(i)->warp_width = width;
 		paragraphs.Get(i)->SloveLayout();
 	}
@@ -724,14 +931,20 @@ int TextEngine::GetAlignMode() {
 
 
 void TextEngine::Clear() {
+	MEMORY_SCOPE(&this->memory);
+	++this->generation;
 	for (size_t i = 0;i < this->paragraphs.GetSize();++i)
 		delete paragraphs.Get(i);
 	paragraphs.Clear();
+	this->index.Clear();
+	//Every block is back in the pools, drop their slabs at once
+	this->pool.Trim();
 }
 
 
 void TextEngine::Append(const char* utf8_str, size_t len) {
-	Array<CPInfo> cps;
+	TEXT_ENGINE_EDIT("TextEngine::Append");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
 	this->_DecodeUtf8(utf8_str, len, cps);
 	if (cps.GetSize() == 0)
 		return;
@@ -740,23 +953,65 @@ void TextEngine::Append(const char* utf8_str, size_t len) {
 
 
 CPPos TextEngine::Insert(const char* utf8_str, size_t len, const CPPos& pos) {
-	CPPos _pos = pos.eol ? this->_PreNextMappedCP(CPPos(pos.paragraph, pos.cp, false), true) : pos;
-	Array<CPInfo> cps;
+	TEXT_ENGINE_EDIT("TextEngine::Insert");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
 	this->_DecodeUtf8(utf8_str, len, cps);
+	return this->_Insert(cps, pos);
+}
+
+
+void TextEngine::Append(const uint16_t* utf16_str, size_t len) {
+	TEXT_ENGINE_EDIT("TextEngine::Append");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	this->_DecodeUtf16(utf16_str, len, cps);
+	if (cps.GetSize() == 0)
+		return;
+	this->_Append(cps);
+}
+
+
+CPPos TextEngine::Insert(const uint16_t* utf16_str, size_t len, const CPPos& pos) {
+	TEXT_ENGINE_EDIT("TextEngine::Insert");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	this->_DecodeUtf16(utf16_str, len, cps);
+	return this->_Insert(cps, pos);
+}
+
+
+void TextEngine::Append(const uint32_t* utf32_str, size_t len) {
+	TEXT_ENGINE_EDIT("TextEngine::Append");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	this->_DecodeUtf32(utf32_str, len, cps);
+	if (cps.GetSize() == 0)
+		return;
+	this->_Append(cps);
+}
+
+
+CPPos TextEngine::Insert(const uint32_t* utf32_str, size_t len, const CPPos& pos) {
+	TEXT_ENGINE_EDIT("TextEngine::Insert");
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	this->_DecodeUtf32(utf32_str, len, cps);
+	return this->_Insert(cps, pos);
+}
+
+
+CPPos TextEngine::_Insert(CodepointArray& cps, const CPPos& pos) {
 	size_t cp_num = cps.GetSize();
 	if (cp_num == 0)
 		return pos;
+	CPPos _pos = pos.eol ? this->_PreNextMappedCP(CPPos(pos.paragraph, pos.cp, false), true) : pos;
 
-	Array<size_t> segments;
-	LineBreaker lb(&cps, cp_num, CodepointAt);
+	Array<size_t> segments(128, MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	LineBreaker lb(cps.GetCodepointBuffer(), cp_num, nullptr);
 	LineBreaker::Break br;
 	size_t begin = 0;
-	while (lb.NextBreak(br)) {
+	while (NextLineBreak(lb, br)) {
 		if (br.position < cp_num)
-			CP_FLAG_SET(cps.Get(br.position).flags, CP_FLAG_CAN_BREAK, true);
+			CP_FLAG_SET(cps.GetFlags(br.position), CP_FLAG_CAN_BREAK, true);
 		if (br.required || br.position == cp_num) {
 			segments.Push(br.position);
-			if (br.position == cp_num && cps.Get(br.position - 1).codepoint == '\n')
+			if (br.position == cp_num && cps.GetCodepoint(br.position - 1) == '\n')
 				segments.Push(br.position);
 		}
 
@@ -771,78 +1026,80 @@ CPPos TextEngine::Insert(const char* utf8_str, size_t len, const CPPos& pos) {
 		ret.cp = PARAGRAPH_NUM > 0 ? CP_NUM(PARAGRAPH_NUM - 1) : 0;
 	}
 	else {
+		bool terminated = EndsWithSeparator(PARAGRAPH(_pos.paragraph)->cps);
 		if (segments.GetSize() == 1) {
 			Paragraph* pi = PARAGRAPH(_pos.paragraph);
-			if (CP_NUM(_pos.paragraph) > 0) {
-				for (size_t i = CP_NUM(_pos.paragraph) - 1;i >= _pos.cp;--i) {
-					pi->cps.Set(i + segments.Get(0), pi->cps.Get(i));
-					if (i == 0)
-						break;
-				}
-			}
-			for (size_t i = 0;i < segments.Get(0);++i)
-				pi->cps.Set(_pos.cp + i, cps.Get(i));
+			pi->cps.InsertRange(_pos.cp, cps, 0, segments.Get(0));
 			ret.paragraph = _pos.paragraph;
 			ret.cp = _pos.cp + segments.Get(0);
-			SloveLineBreak(pi->cps);
-			pi->SloveBidi();
-			pi->SloveLayout();
+			this->_KeepParagraphEnd(_pos.paragraph, terminated);
+			RelayoutParagraph(pi, _pos.paragraph, true);
+			this->_IndexParagraph(_pos.paragraph);
 		}
 		else {
-			Array<Paragraph*> ps;
+			Array<Paragraph*> ps(128, MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
 			size_t sn = segments.GetSize();
 			Paragraph* last = new Paragraph(this->ff, this->warp_width);
 			for (size_t i = 0;i < sn;++i) {
 				if (i == 0) {
 					size_t last_s = segments.GetSize() - 1;
-					for (size_t j = segments.Get(last_s - 1);j < segments.Get(last_s);++j)
-						if (cps.Get(j).codepoint != '\n')
-							last->cps.Push(cps.Get(j));
+					size_t s_begin = segments.Get(last_s - 1);
+					last->cps.AppendRange(cps, s_begin, ParagraphTextEnd(cps, s_begin, segments.Get(last_s), cps.GetCodepoint(s_begin - 1)) - s_begin);
 					ret.cp = last->cps.GetSize();
 					Paragraph* pi = PARAGRAPH(_pos.paragraph);
-					for (size_t j = _pos.cp;j < pi->cps.GetSize();++j)
-						last->cps.Push(pi->cps.Get(j));
-					pi->cps.SetCapacity(_pos.cp);
-					for (size_t j = 0;j < segments.Get(0);++j)
-						if (cps.Get(j).codepoint != '\n')
-							pi->cps.Push(cps.Get(j));
-					SloveLineBreak(pi->cps);
-					pi->SloveBidi();
-					pi->SloveLayout();
+					last->cps.AppendRange(pi->cps, _pos.cp, pi->cps.GetSize() - _pos.cp);
+					TruncateCodepoints(pi->cps, _pos.cp);
+					pi->cps.AppendRange(cps, 0, ParagraphTextEnd(cps, 0, segments.Get(0), _pos.cp > 0 ? pi->cps.GetCodepoint(_pos.cp - 1) : 0));
+					RelayoutParagraph(pi, _pos.paragraph, true);
 				}
 				else if (i == sn - 1) {
-					SloveLineBreak(last->cps);
-					last->SloveBidi();
-					last->SloveLayout();
+					FitCodepoints(last->cps);
+					RelayoutParagraph(last, _pos.paragraph + i, true);
 					ps.Push(last);
 				}
 				else {
 					Paragraph* np = new Paragraph(this->ff, this->warp_width);
-					for (size_t j = segments.Get(i - 1);j < segments.Get(i);++j)
-						if (cps.Get(j).codepoint != '\n')
-							np->cps.Push(cps.Get(j));
-					np->SloveBidi();
-					np->SloveLayout();
+					size_t s_begin = segments.Get(i - 1);
+					np->cps.AppendRange(cps, s_begin, ParagraphTextEnd(cps, s_begin, segments.Get(i), cps.GetCodepoint(s_begin - 1)) - s_begin);
+					FitCodepoints(np->cps);
+					RelayoutParagraph(np, _pos.paragraph + i, false);
 					ps.Push(np);
 				}
 			}
-			size_t i = PARAGRAPH_NUM - 1;
-			while (i > _pos.paragraph) {
-				this->paragraphs.Set(i + ps.GetSize(), this->paragraphs.Get(i));
-				if (i == 0)
-					break;
-				--i;
-			}
-			for (size_t i = 0;i < ps.GetSize();++i)
-				this->paragraphs.Set(_pos.paragraph + 1 + i, ps.Get(i));
+			this->paragraphs.InsertRange(_pos.paragraph + 1, ps, 0, ps.GetSize());
+			this->index.Insert(_pos.paragraph + 1, ps.GetSize());
+			for (size_t i = 0;i <= ps.GetSize();++i)
+				this->_IndexParagraph(_pos.paragraph + i);
 			ret.paragraph = _pos.paragraph + ps.GetSize();
+			if (this->_KeepParagraphEnd(ret.paragraph, terminated)) {
+				RelayoutParagraph(PARAGRAPH(ret.paragraph), ret.paragraph, true);
+				this->_IndexParagraph(ret.paragraph);
+			}
 		}
 	}
 	return ret;
 }
 
 
+//An edit that changes whether a paragraph ends with a separator keeps the
+//exported text as edited, a newline the paragraph implied stays and one it did
+//not imply is not added. True if the paragraph changed.
+bool TextEngine::_KeepParagraphEnd(size_t paragraph, bool terminated) {
+	CodepointArray& cps = PARAGRAPH(paragraph)->cps;
+	if (paragraph + 1 >= PARAGRAPH_NUM || EndsWithSeparator(cps) == terminated)
+		return false;
+	if (terminated) {
+		cps.AppendRange(PARAGRAPH(paragraph + 1)->cps, 0, CP_NUM(paragraph + 1));
+		this->_DeleteParagraphs(paragraph + 1, 1);
+	}
+	else
+		cps.Push('\n');
+	return true;
+}
+
+
 void TextEngine::Delete(const CPPos& a, const CPPos& b) {
+	TEXT_ENGINE_EDIT("TextEngine::Delete");
 	CPPos _a = a.eol ? this->_PreNextMappedCP(CPPos(a.paragraph, a.cp, false), true) : a;
 	CPPos _b = b.eol ? this->_PreNextMappedCP(CPPos(b.paragraph, b.cp, false), true) : b;
 	if (_a == _b)
@@ -852,40 +1109,286 @@ void TextEngine::Delete(const CPPos& a, const CPPos& b) {
 	else if (_a.paragraph == _b.paragraph && _b.cp < _a.cp)
 		CP_SWAP(_a, _b);
 
+	bool terminated = EndsWithSeparator(PARAGRAPH(_b.paragraph)->cps);
 	if (_a.paragraph == _b.paragraph) {
-		for (size_t i = _b.cp;i < CP_NUM(_a.paragraph);++i)
-			SET_CP(_a.paragraph, i - (_b.cp - _a.cp), CP(_a.paragraph, i));
-		PARAGRAPH(_a.paragraph)->cps.SetCapacity(CP_NUM(_a.paragraph) - (_b.cp - _a.cp));
+		PARAGRAPH(_a.paragraph)->cps.RemoveRange(_a.cp, _b.cp - _a.cp);
+		TruncateCodepoints(PARAGRAPH(_a.paragraph)->cps, CP_NUM(_a.paragraph));
 	}
 	else {
-		for (size_t p = _a.paragraph;p <= _b.paragraph;++p) {
-			if (p == _a.paragraph)
-				PARAGRAPH(p)->cps.SetCapacity(_a.cp);
-			else if (p == _b.paragraph) {
-				for (size_t i = _b.cp;i < CP_NUM(_b.paragraph);++i)
-					PARAGRAPH(_a.paragraph)->cps.Push(CP(_b.paragraph, i));
-			}
-		}
+		TruncateCodepoints(PARAGRAPH(_a.paragraph)->cps, _a.cp);
+		PARAGRAPH(_a.paragraph)->cps.AppendRange(PARAGRAPH(_b.paragraph)->cps, _b.cp, CP_NUM(_b.paragraph) - _b.cp);
 		this->_DeleteParagraphs(_a.paragraph + 1, _b.paragraph - _a.paragraph);
 	}
-	SloveLineBreak(PARAGRAPH(_a.paragraph)->cps);
-	PARAGRAPH(_a.paragraph)->SloveBidi();
-	PARAGRAPH(_a.paragraph)->SloveLayout();
+	this->_KeepParagraphEnd(_a.paragraph, terminated);
+	RelayoutParagraph(PARAGRAPH(_a.paragraph), _a.paragraph, true);
+	this->_IndexParagraph(_a.paragraph);
+	//A large delete gives back the slabs it emptied rather than keeping them to Clear
+	this->pool.TrimIdle();
 }
 
 
-CPPos TextEngine::Replace(const char* utf8_str, size_t len, const CPPos& a, const CPPos& b) {
+//Deletes the range and returns where the replacement goes
+CPPos TextEngine::_DeleteReplaced(const CPPos& a, const CPPos& b) {
 	CPPos _a = a.eol ? this->_PreNextMappedCP(CPPos(a.paragraph, a.cp, false), true) : a;
 	CPPos _b = b.eol ? this->_PreNextMappedCP(CPPos(b.paragraph, b.cp, false), true) : b;
 	if (_a == _b)
-		return this->Insert(utf8_str, len, _a);
+		return _a;
 	if (_b.paragraph < _a.paragraph)
 		CP_SWAP(_a, _b)
 	else if (_a.paragraph == _b.paragraph && _b.cp < _a.cp)
 		CP_SWAP(_a, _b);
 
 	this->Delete(_a, _b);
-	return this->Insert(utf8_str, len, _a);
+	return _a;
+}
+
+
+CPPos TextEngine::Replace(const char* utf8_str, size_t len, const CPPos& a, const CPPos& b) {
+	TEXT_ENGINE_EDIT("TextEngine::Replace");
+	return this->Insert(utf8_str, len, this->_DeleteReplaced(a, b));
+}
+
+
+CPPos TextEngine::Replace(const uint16_t* utf16_str, size_t len, const CPPos& a, const CPPos& b) {
+	TEXT_ENGINE_EDIT("TextEngine::Replace");
+	return this->Insert(utf16_str, len, this->_DeleteReplaced(a, b));
+}
+
+
+CPPos TextEngine::Replace(const uint32_t* utf32_str, size_t len, const CPPos& a, const CPPos& b) {
+	TEXT_ENGINE_EDIT("TextEngine::Replace");
+	return this->Insert(utf32_str, len, this->_DeleteReplaced(a, b));
+}
+
+
+//Bytes handed to a TextSink at a time
+#define TEXT_SINK_BUFFER	16384
+
+
+struct TextExport {
+	unsigned char* buffer;
+	size_t capacity;
+	size_t len = 0;
+	//Bytes of the whole range, still counted once the buffer is full
+	size_t total = 0;
+	TextSink sink = nullptr;
+	void* user = nullptr;
+	bool full = false;
+	bool stopped = false;
+
+	TextExport(unsigned char* buffer, size_t capacity) :buffer(buffer), capacity(capacity) {}
+};
+
+
+//Encodes codepoints into the buffer and hands it to the sink when it fills. A
+//caller buffer only keeps counting once a codepoint does not fit.
+void ExportCodepoints(TextExport& ex, const uint32_t* codepoints, size_t n) {
+	while (n > 0 && !ex.stopped) {
+		if (ex.full) {
+			ex.total += UTF8EncodedLength(codepoints, n);
+			return;
+		}
+		size_t consumed;
+		size_t bytes = UTF8EncodeRange(codepoints, n, ex.buffer + ex.len, ex.capacity - ex.len, consumed);
+		ex.len += bytes;
+		ex.total += bytes;
+		codepoints += consumed;
+		n -= consumed;
+		if (n == 0)
+			return;
+		if (ex.sink == nullptr)
+			ex.full = true;
+		else {
+			ex.stopped = !ex.sink(ex.user, reinterpret_cast<const char*>(ex.buffer), ex.len);
+			ex.len = 0;
+		}
+	}
+}
+
+
+void TextEngine::_ExportText(const CPPos& a, const CPPos& b, TextExport& ex) {
+	if (PARAGRAPH_NUM == 0)
+		return;
+	CPPos _a = a.eol ? this->_PreNextMappedCP(CPPos(a.paragraph, a.cp, false), true) : a;
+	CPPos _b = b.eol ? this->_PreNextMappedCP(CPPos(b.paragraph, b.cp, false), true) : b;
+	if (_b.paragraph < _a.paragraph)
+		CP_SWAP(_a, _b)
+	else if (_a.paragraph == _b.paragraph && _b.cp < _a.cp)
+		CP_SWAP(_a, _b);
+	if (_b.paragraph >= PARAGRAPH_NUM)
+		_b = CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1));
+	const uint32_t newline = '\n';
+	for (size_t p = _a.paragraph;p <= _b.paragraph && !ex.stopped;++p) {
+		const CodepointArray& cps = PARAGRAPH(p)->cps;
+		size_t cp_num = cps.GetSize();
+		size_t end = p == _b.paragraph && _b.cp < cp_num ? _b.cp : cp_num;
+		size_t start = p == _a.paragraph ? (_a.cp < end ? _a.cp : end) : 0;
+		ExportCodepoints(ex, cps.GetCodepointBuffer() + start, end - start);
+		if (p < _b.paragraph && !EndsWithSeparator(cps))
+			ExportCodepoints(ex, &newline, 1);
+	}
+}
+
+
+size_t TextEngine::GetText(const CPPos& a, const CPPos& b, char* utf8_str, size_t max_len) {
+	TextExport ex(reinterpret_cast<unsigned char*>(utf8_str), utf8_str == nullptr ? 0 : max_len);
+	this->_ExportText(a, b, ex);
+	return ex.total;
+}
+
+
+bool TextEngine::ExportText(const CPPos& a, const CPPos& b, TextSink sink, void* user) {
+	unsigned char buffer[TEXT_SINK_BUFFER];
+	TextExport ex(buffer, TEXT_SINK_BUFFER);
+	ex.sink = sink;
+	ex.user = user;
+	this->_ExportText(a, b, ex);
+	if (!ex.stopped && ex.len > 0)
+		ex.stopped = !sink(user, reinterpret_cast<const char*>(buffer), ex.len);
+	return !ex.stopped;
+}
+
+
+size_t TextEngine::GetText(char* utf8_str, size_t max_len) {
+	if (PARAGRAPH_NUM == 0)
+		return 0;
+	return this->GetText(CPPos(0, 0), CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1)), utf8_str, max_len);
+}
+
+
+bool TextEngine::ExportText(TextSink sink, void* user) {
+	if (PARAGRAPH_NUM == 0)
+		return true;
+	return this->ExportText(CPPos(0, 0), CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1)), sink, user);
+}
+
+
+//Codepoints of cps before the one holding byte, the size once byte is past them
+size_t CodepointAtByte(const CodepointArray& cps, size_t byte) {
+	const uint32_t* codepoints = cps.GetCodepointBuffer();
+	size_t cp_num = cps.GetSize();
+	size_t bytes = 0;
+	for (size_t i = 0;i < cp_num;++i) {
+		bytes += UTF8EncodedSize(codepoints[i]);
+		if (bytes > byte)
+			return i;
+	}
+	return cp_num;
+}
+
+
+size_t BytesBeforeCodepoint(const CodepointArray& cps, size_t cp) {
+	return UTF8EncodedLength(cps.GetCodepointBuffer(), cp);
+}
+
+
+CPPos TextEngine::ByteOffsetToPos(size_t offset) {
+	if (PARAGRAPH_NUM == 0)
+		return CPPos();
+	size_t local;
+	size_t p = this->index.FindByte(offset, local);
+	if (p >= PARAGRAPH_NUM)
+		return CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1));
+	return CPPos(p, CodepointAtByte(PARAGRAPH(p)->cps, local));
+}
+
+
+size_t TextEngine::PosToByteOffset(const CPPos& pos) {
+	if (PARAGRAPH_NUM == 0)
+		return 0;
+	size_t p = pos.paragraph < PARAGRAPH_NUM ? pos.paragraph : PARAGRAPH_NUM - 1;
+	size_t cp = pos.paragraph < PARAGRAPH_NUM && pos.cp < CP_NUM(p) ? pos.cp : CP_NUM(p);
+	return this->index.GetPrefix(p).bytes + BytesBeforeCodepoint(PARAGRAPH(p)->cps, cp);
+}
+
+
+CPPos TextEngine::CodepointOffsetToPos(size_t offset) {
+	if (PARAGRAPH_NUM == 0)
+		return CPPos();
+	size_t local;
+	size_t p = this->index.FindCodepoint(offset, local);
+	if (p >= PARAGRAPH_NUM)
+		return CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1));
+	return CPPos(p, local < CP_NUM(p) ? local : CP_NUM(p));
+}
+
+
+size_t TextEngine::PosToCodepointOffset(const CPPos& pos) {
+	if (PARAGRAPH_NUM == 0)
+		return 0;
+	size_t p = pos.paragraph < PARAGRAPH_NUM ? pos.paragraph : PARAGRAPH_NUM - 1;
+	size_t cp = pos.paragraph < PARAGRAPH_NUM && pos.cp < CP_NUM(p) ? pos.cp : CP_NUM(p);
+	return this->index.GetPrefix(p).cps + cp;
+}
+
+
+CPPos TextEngine::LineColumnToPos(size_t line, size_t column) {
+	if (PARAGRAPH_NUM == 0)
+		return CPPos();
+	if (line >= PARAGRAPH_NUM)
+		return CPPos(PARAGRAPH_NUM - 1, CP_NUM(PARAGRAPH_NUM - 1));
+	return CPPos(line, CodepointAtByte(PARAGRAPH(line)->cps, column));
+}
+
+
+void TextEngine::PosToLineColumn(const CPPos& pos, size_t& line, size_t& column) {
+	line = 0;
+	column = 0;
+	if (PARAGRAPH_NUM == 0)
+		return;
+	line = pos.paragraph < PARAGRAPH_NUM ? pos.paragraph : PARAGRAPH_NUM - 1;
+	size_t cp = pos.paragraph < PARAGRAPH_NUM && pos.cp < CP_NUM(line) ? pos.cp : CP_NUM(line);
+	column = BytesBeforeCodepoint(PARAGRAPH(line)->cps, cp);
+}
+
+
+const PipelineStats& TextEngine::GetPipelineStats() {
+	return this->stats;
+}
+
+
+void TextEngine::ResetPipelineStats() {
+	this->stats.Reset();
+}
+
+
+void TextEngine::SetTraceRecorder(TraceRecorder* recorder) {
+	this->trace = recorder;
+}
+
+
+void TextEngine::SetLibraryAllocator(const MemoryAllocator* allocator) {
+	this->memory.SetAllocator(allocator);
+}
+
+
+void TextEngine::SetLibraryLimit(size_t bytes) {
+	MEMORY_SCOPE(&this->memory);
+	this->memory.SetLimit(MEMORY_CATEGORY_BIDI, bytes);
+	for (size_t i = this->paragraphs.GetSize();i > 0 && this->memory.IsOverLimit(MEMORY_CATEGORY_BIDI);--i)
+		this->paragraphs.Get(i - 1)->ReleaseBidi();
+}
+
+
+MemoryStats TextEngine::GetMemoryStats() {
+	MemoryStats ret;
+	this->memory.Fill(ret);
+	size_t pn = this->paragraphs.GetSize();
+	ret.categories[MEMORY_CATEGORY_PARAGRAPHS].used = pn * (sizeof(Paragraph*) + sizeof(Paragraph));
+	for (size_t p = 0;p < pn;++p) {
+		Paragraph* paragraph = this->paragraphs.Get(p);
+		size_t ln = paragraph->lines.GetSize();
+		ret.categories[MEMORY_CATEGORY_CODEPOINTS].used += paragraph->cps.GetSize() * CP_ARRAY_ELEMENT_SIZE;
+		ret.categories[MEMORY_CATEGORY_LINES].used += ln * (sizeof(TextLine*) + sizeof(TextLine));
+		for (size_t l = 0;l < ln;++l)
+			ret.categories[MEMORY_CATEGORY_GLYPHS].used += paragraph->lines.Get(l)->glyphs.GetSize() * sizeof(MappedGlyph);
+	}
+	//SheenBidi objects and leftover temporaries are fully live
+	ret.categories[MEMORY_CATEGORY_BIDI].used = ret.categories[MEMORY_CATEGORY_BIDI].reserved;
+	ret.categories[MEMORY_CATEGORY_SCRATCH].used = ret.categories[MEMORY_CATEGORY_SCRATCH].reserved;
+	ret.categories[MEMORY_CATEGORY_PARAGRAPHS].used += this->index.GetUsedBytes();
+	ret.arena = this->arena.GetReserved();
+	return ret;
 }
 
 
@@ -958,15 +1461,15 @@ CPPos TextEngine::CheckCursorPos(const CPPos& cpp) {
 	if (cpp.cp > CP_NUM(cpp.paragraph))
 		return { cpp.paragraph,CP_NUM(cpp.paragraph)};
 	if (cpp.cp < CP_NUM(cpp.paragraph)) {
-		if (!CP_FLAG_GET(CP(cpp.paragraph, cpp.cp).flags, CP_FLAG_MAPPED))
+		if (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, cpp.cp), CP_FLAG_MAPPED))
 			return { cpp.paragraph,0 };
 		if (cpp.eol) {
-			if (!CP_FLAG_GET(CP(cpp.paragraph, cpp.cp).flags, CP_FLAG_IS_RTL)) {
-				if (CP(cpp.paragraph, cpp.cp).start + CP(cpp.paragraph, cpp.cp).len < GLYPH_NUM(cpp.paragraph, CP(cpp.paragraph, cpp.cp).line))
+			if (!CP_FLAG_GET(CP_FLAGS(cpp.paragraph, cpp.cp), CP_FLAG_IS_RTL)) {
+				if (CP_MAP(cpp.paragraph, cpp.cp).start + CP_MAP(cpp.paragraph, cpp.cp).len < GLYPH_NUM(cpp.paragraph, CP_MAP(cpp.paragraph, cpp.cp).line))
 					return this->_PreNextMappedCP(CPPos(cpp.paragraph, cpp.cp, false), true);
 			}
 			else {
-				if (CP(cpp.paragraph, cpp.cp).start > 0)
+				if (CP_MAP(cpp.paragraph, cpp.cp).start > 0)
 					return this->_PreNextMappedCP(CPPos(cpp.paragraph, cpp.cp, false), true);
 			}
 		}
@@ -1095,4 +1598,178 @@ bool TextEngine::IsGlyphInRange(const GlyphPos& gp, const CPPos& a, const CPPos&
 			ret &= false;
 	}
 	return ret;
-}
\ No newline at end of file
+}
+
+////////////////
+//TextAppender//
+////////////////
+void TextEngine::_OpenAppenderParagraph(TextAppender& appender) {
+	appender.open_index = this->paragraphs.GetSize() - 1;
+	appender.open = this->paragraphs.Get(appender.open_index);
+	appender.lb = LineBreaker(&appender.open->cps, 0, CodepointAt);
+	appender.open_seen = 0;
+}
+
+
+//False once anything else edited or cleared the engine since the appender
+//last wrote to it
+bool TextEngine::_IsAppenderOpen(const TextAppender& appender) {
+	return appender.open != nullptr && appender.generation == this->generation;
+}
+
+
+void TextEngine::_SyncAppender(TextAppender& appender) {
+	if (this->_IsAppenderOpen(appender))
+		return;
+	this->_GetLastParagraph();
+	this->_OpenAppenderParagraph(appender);
+	//Its breaks are solved, only the breaker state is rebuilt. Codepoints the
+	//appender left to lay out stay pending in laid_out of the paragraph
+	size_t cp_num = appender.open->cps.GetSize();
+	if (cp_num > 0) {
+		appender.lb.Extend(cp_num);
+		LineBreaker::Break br;
+		while (NextLineBreak(appender.lb, br));
+	}
+	appender.open_seen = cp_num;
+	appender.generation = this->generation;
+}
+
+
+//Lays out the open paragraph for good and opens a new one after it, a newline
+//ending it is dropped like Append does
+void TextEngine::_CloseAppenderParagraph(TextAppender& appender) {
+	Paragraph* open = appender.open;
+	size_t cp_num = ParagraphTextEnd(open->cps, 0, open->cps.GetSize(), 0);
+	if (cp_num < open->cps.GetSize())
+		open->cps.Truncate(cp_num);
+	FitCodepoints(open->cps);
+	RelayoutParagraph(open, appender.open_index, false);
+	this->_IndexParagraph(appender.open_index);
+	this->_PushParagraph();
+	this->_OpenAppenderParagraph(appender);
+}
+
+
+//Codepoints go into the open paragraph one at a time. A required break is only
+//reported once the codepoint after it is seen, that one opens the next paragraph.
+void TextEngine::_StreamCodepoints(TextAppender& appender, const CodepointArray& cps) {
+	LineBreaker::Break br;
+	for (size_t i = 0;i < cps.GetSize();++i) {
+		uint32_t codepoint = cps.GetCodepointUnchecked(i);
+		Paragraph* open = appender.open;
+		open->cps.Push(codepoint);
+		this->index.Grow(appender.open_index, UTF8EncodedSize(codepoint), 1);
+		size_t cp_num = ++appender.open_seen;
+		appender.lb.Extend(cp_num);
+		bool required = false;
+		while (NextLineBreak(appender.lb, br)) {
+			if (br.position >= cp_num)
+				continue;
+			if (br.required) {
+				required = true;
+				break;
+			}
+			CP_FLAG_SET(open->cps.GetFlagsUnchecked(br.position), CP_FLAG_CAN_BREAK, true);
+		}
+		if (required) {
+			open->cps.Truncate(cp_num - 1);
+			this->_CloseAppenderParagraph(appender);
+			appender.open->cps.Push(codepoint);
+			this->index.Grow(appender.open_index, UTF8EncodedSize(codepoint), 1);
+			appender.open_seen = 1;
+			appender.lb.Extend(1);
+			while (NextLineBreak(appender.lb, br));
+		}
+		//A newline breaks whatever follows, no need to wait for it
+		if (codepoint == '\n')
+			this->_CloseAppenderParagraph(appender);
+	}
+}
+
+
+void TextEngine::_AppenderWrite(TextAppender& appender, const char* utf8_str, size_t len) {
+	TEXT_ENGINE_SCOPE("TextAppender::Write");
+	const unsigned char* str = reinterpret_cast<const unsigned char*>(utf8_str);
+	CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+	size_t begin = 0;
+	if (appender.partial_len > 0) {
+		//The kept bytes are a valid start, at most three more finish or break it
+		unsigned char head[8];
+		size_t head_len = appender.partial_len;
+		size_t n = len < 3 ? len : 3;
+		memcpy(head, appender.partial, head_len);
+		memcpy(head + head_len, str, n);
+		head_len += n;
+		if (n == len && UTF8IncompleteTail(head, head_len) == head_len) {
+			memcpy(appender.partial, head, head_len);
+			appender.partial_len = head_len;
+			return;
+		}
+		uint32_t codepoint;
+		size_t consumed;
+		UTF8DecodeRange(head, head_len, &codepoint, 1, consumed);
+		cps.Push(codepoint);
+		begin = consumed - appender.partial_len;
+		appender.partial_len = 0;
+	}
+	size_t tail = UTF8IncompleteTail(str + begin, len - begin);
+	this->_DecodeUtf8(utf8_str + begin, len - begin - tail, cps);
+	memcpy(appender.partial, str + len - tail, tail);
+	appender.partial_len = tail;
+	if (cps.GetSize() == 0)
+		return;
+	this->_SyncAppender(appender);
+	this->_StreamCodepoints(appender, cps);
+	//Other appenders of the engine see the change
+	appender.generation = ++this->generation;
+	//Waiting for the paragraph to double keeps the layouts of a long one linear
+	Paragraph* open = appender.open;
+	size_t pending = open->cps.GetSize() - open->laid_out;
+	if (pending >= APPENDER_LAYOUT_MIN && pending >= open->laid_out)
+		RelayoutParagraph(open, appender.open_index, false);
+}
+
+
+void TextEngine::_AppenderFlush(TextAppender& appender, bool end) {
+	TEXT_ENGINE_SCOPE(end ? "TextAppender::End" : "TextAppender::Flush");
+	if (end && appender.partial_len > 0) {
+		CodepointArray cps(MEMORY_HOOKS(MEMORY_CATEGORY_SCRATCH));
+		this->_DecodeUtf8(reinterpret_cast<const char*>(appender.partial), appender.partial_len, cps);
+		appender.partial_len = 0;
+		this->_SyncAppender(appender);
+		this->_StreamCodepoints(appender, cps);
+		appender.generation = ++this->generation;
+	}
+	if (appender.open == nullptr || this->paragraphs.GetSize() == 0)
+		return;
+	//Edits since the last write relayout the paragraphs they touch, codepoints
+	//still pending can only be left in the last one
+	this->_SyncAppender(appender);
+	Paragraph* open = appender.open;
+	if (open->cps.GetSize() != open->laid_out)
+		RelayoutParagraph(open, appender.open_index, false);
+}
+
+
+TextAppender::TextAppender(TextEngine* te) :te(te), lb(nullptr, 0, CodepointAt) {}
+
+
+void TextAppender::Write(const char* utf8_str, size_t len) {
+	this->te->_AppenderWrite(*this, utf8_str, len);
+}
+
+
+void TextAppender::Flush() {
+	this->te->_AppenderFlush(*this, false);
+}
+
+
+void TextAppender::End() {
+	this->te->_AppenderFlush(*this, true);
+}
+
+
+TextAppender::~TextAppender() {
+	this->End();
+}
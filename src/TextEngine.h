@@ -7,8 +7,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <SheenBidi/SheenBidi.h>
+#include <LineBreaker.h>
 #include "Array.h"
 #include "FontCollection.h"
+#include "PipelineStats.h"
+#include "TraceRecorder.h"
+#include "MemoryStats.h"
+#include "ParagraphIndex.h"
+#include "CodepointArray.h"
 
 #define TEXT_ALIGN_AUTO		0
 #define TEXT_ALIGN_LEFT		1
@@ -19,26 +25,19 @@
 #define CP_FLAG_CAN_BREAK	(0x1U<<1)
 #define CP_FLAG_MAPPED		(0x1U<<2)
 
+//Spare codepoints Paragraph::cps keeps past its size when it shrinks
+#define CP_BLOCK_SIZE		128
+//Lines of a paragraph and paragraphs of an engine stored inline, enough for a
+//label or a single line text field
+#define INLINE_LINE_NUM		2
+#define INLINE_PARAGRAPH_NUM	1
+//Codepoints the open paragraph of a TextAppender gains at least before it is
+//laid out again, the interval grows with the paragraph
+#define APPENDER_LAYOUT_MIN	4096
+
 #define CP_FLAG_GET(flags,mask) ((flags&mask)!=0)
 #define CP_FLAG_SET(flags,mask,value) ((value)?(flags|=mask):(flags&=(~mask)))
 
-struct CPInfo {
-	uint32_t codepoint;
-	uint8_t flags;
-	size_t line;
-	size_t start;
-	size_t len;
-
-	CPInfo(
-		uint32_t codepoint = 0,
-		uint8_t flags = 0x0U,
-		size_t line = 0,
-		size_t start = 0,
-		size_t len = 0
-		):codepoint(codepoint),flags(flags),line(line),start(start),len(len){ }
-};
-
-
 struct MappedGlyph {
 	size_t map;
 	GlyphInfo gi;
@@ -51,7 +50,8 @@ struct TextLine {
 	Array<MappedGlyph> glyphs;
 	float width = 0;
 
-	TextLine(size_t index):index(index){}
+	MEMORY_TRACKED_NEW(MEMORY_CATEGORY_LINES)
+	TextLine(size_t index):index(index), glyphs(128, MEMORY_HOOKS(MEMORY_CATEGORY_GLYPHS)){}
 	void Append(uint32_t glyph_index, size_t map, uint32_t codepoint, bool is_ltr, Font* font, FontCollection* ff);
 };
 
@@ -61,19 +61,29 @@ class Paragraph {
 	SBParagraphRef sbp = nullptr;
 	SBUInteger sbpl = 0;
 	SBLineRef sbl = nullptr;
+	//Lines dropped by ClearLines, reused with their glyph blocks
+	Array<TextLine*, INLINE_LINE_NUM> spare_lines;
 
+	TextLine* _NewLine(size_t index);
 	TextLine* _GetLastLine();
 	void _AppendNewLine();
+	void _TrimSpareLines();
 
 public:
 	float warp_width = -1;
 	FontCollection* ff;
-	Array<CPInfo> cps;
-	Array<TextLine*> lines;
+	CodepointArray cps;
+	Array<TextLine*, INLINE_LINE_NUM> lines;
+	//Codepoints at the last full relayout, a TextAppender lays out again while
+	//it differs from the size
+	size_t laid_out = 0;
 
+	MEMORY_TRACKED_NEW(MEMORY_CATEGORY_PARAGRAPHS)
 	Paragraph(FontCollection* ff, float warp_width = -1);
-	void Insert(size_t pos, const Array<CPInfo>& cps, size_t start, size_t len);
+	void Insert(size_t pos, const CodepointArray& cps, size_t start, size_t len);
 	void SloveBidi();
+	//Drops the SheenBidi objects, SloveLayout solves them again when needed
+	void ReleaseBidi();
 	void SloveLayout();
 	void ClearLines();
 	~Paragraph();
@@ -133,16 +143,51 @@ struct CPPos {
 #define CP_SWAP(a,b) {CPPos temp=a;a=b;b=temp;}
 
 
+class TextAppender;
+struct TextExport;
+
+
+//Receives exported UTF-8 in pieces, returning false stops the export
+typedef bool (*TextSink)(void* user, const char* utf8_str, size_t len);
+
+
 class TextEngine {
+	friend class TextAppender;
 	int align_mode = TEXT_ALIGN_AUTO;
 	float warp_width = -1;
 	FontCollection* ff;
-	Array<Paragraph*> paragraphs;
+	//Paragraph data, must outlive paragraphs
+	MemoryPool pool;
+	//Scratch of one edit, rewound when it returns and after each layout run
+	MemoryArena arena;
+	MemoryAccount memory;
+	Array<Paragraph*, INLINE_PARAGRAPH_NUM> paragraphs;
+	//Byte and codepoint offsets of paragraphs, kept along every edit
+	ParagraphIndex index;
+	PipelineStats stats;
+	TraceRecorder* trace = nullptr;
+	//Bumped by every edit and Clear, see TextAppender::generation
+	uint64_t generation = 0;
 
 	Paragraph* _GetLastParagraph();
-	void _DecodeUtf8(const char* utf8_str, size_t len, Array<CPInfo>& cps);
-	void _Append(const Array<CPInfo>& cps);
+	void _PushParagraph();
+	void _IndexParagraph(size_t index);
+	void _DecodeUtf8(const char* utf8_str, size_t len, CodepointArray& cps);
+	void _DecodeUtf16(const uint16_t* utf16_str, size_t len, CodepointArray& cps);
+	void _DecodeUtf32(const uint32_t* utf32_str, size_t len, CodepointArray& cps);
+	void _Append(const CodepointArray& cps);
+	CPPos _Insert(CodepointArray& cps, const CPPos& pos);
+	CPPos _DeleteReplaced(const CPPos& start, const CPPos& end);
+	bool _IsAppenderOpen(const TextAppender& appender);
+	void _SyncAppender(TextAppender& appender);
+	void _OpenAppenderParagraph(TextAppender& appender);
+	void _CloseAppenderParagraph(TextAppender& appender);
+	void _StreamCodepoints(TextAppender& appender, const CodepointArray& cps);
+	void _AppenderWrite(TextAppender& appender, const char* utf8_str, size_t len);
+	void _AppenderFlush(TextAppender& appender, bool end);
+	void _ExportText(const CPPos& a, const CPPos& b, TextExport& ex);
 	void _DeleteParagraphs(size_t start, size_t len);
+	bool _KeepParagraphEnd(size_t paragraph, bool terminated);
 	CPPos _GPos2CPPos(const GlyphPos& gp);
  	bool _CPPos2GPos(const CPPos& cpp, GlyphPos& gp);
 	CPPos _NextCodepoint(const CPPos& cpp);
@@ -153,6 +198,7 @@ class TextEngine {
 
 public:
 	TextEngine(FontCollection* ff, float warp_width = -1);
+	~TextEngine();
 	void SetWarpWidth(float width);
 	float GetWarpWidth();
 	void SetAlignMode(int mode);
@@ -162,6 +208,37 @@ public:
 	CPPos Insert(const char* utf8_str, size_t len, const CPPos& pos);
 	void Delete(const CPPos& start, const CPPos& end);
 	CPPos Replace(const char* utf8_str, size_t len, const CPPos& start, const CPPos& end);
+	//UTF-16 as the JS and Java bridges hand it, len counts 16 bit units and a
+	//surrogate without its pair becomes U+FFFD
+	void Append(const uint16_t* utf16_str, size_t len);
+	CPPos Insert(const uint16_t* utf16_str, size_t len, const CPPos& pos);
+	CPPos Replace(const uint16_t* utf16_str, size_t len, const CPPos& start, const CPPos& end);
+	//Codepoints already decoded, surrogates and values past U+10FFFF become U+FFFD
+	void Append(const uint32_t* utf32_str, size_t len);
+	CPPos Insert(const uint32_t* utf32_str, size_t len, const CPPos& pos);
+	CPPos Replace(const uint32_t* utf32_str, size_t len, const CPPos& start, const CPPos& end);
+	//UTF-8 of the range Delete would remove, with a newline between paragraphs
+	//unless one ends with a separator of its own (CR, VT, FF, NEL, LS, PS, or a
+	//newline kept after one of them as in CRLF).
+	//Writes the whole codepoints that fit in max_len bytes, utf8_str may be
+	//nullptr to measure. Returns the length of the whole range.
+	size_t GetText(const CPPos& start, const CPPos& end, char* utf8_str, size_t max_len);
+	//Same text passed to sink in pieces, false if the sink stopped it
+	bool ExportText(const CPPos& start, const CPPos& end, TextSink sink, void* user);
+	//Whole document
+	size_t GetText(char* utf8_str, size_t max_len);
+	bool ExportText(TextSink sink, void* user);
+	//Offsets into the text GetText exports in O(log n) of the paragraphs. An
+	//offset inside a codepoint or on a newline maps to where that starts,
+	//past the text to the end of the document.
+	CPPos ByteOffsetToPos(size_t offset);
+	size_t PosToByteOffset(const CPPos& pos);
+	CPPos CodepointOffsetToPos(size_t offset);
+	size_t PosToCodepointOffset(const CPPos& pos);
+	//Lines are paragraphs and columns count UTF-8 bytes, as in the utf-8
+	//position encoding of LSP
+	CPPos LineColumnToPos(size_t line, size_t column);
+	void PosToLineColumn(const CPPos& pos, size_t& line, size_t& column);
 	size_t GetParagarphNum();
 	Paragraph* GetParagraph(size_t index);
 	CPPos Hit(float lh, float x, float y);
@@ -173,6 +250,55 @@ public:
 	CPPos CursorLeft(const CPPos& pos);
 	CPPos CursorRight(const CPPos& pos);
 	bool IsGlyphInRange(const GlyphPos& gp, const CPPos& a, const CPPos& b);
+	//Only updated when built with TEXT_ENGINE_STATS
+	const PipelineStats& GetPipelineStats();
+	void ResetPipelineStats();
+	//Record spans of the following edits into recorder, nullptr to stop
+	void SetTraceRecorder(TraceRecorder* recorder);
+	//SheenBidi blocks of this engine come from allocator, nullptr for the
+	//per-thread recycle bin. HarfBuzz objects are shared between engines and
+	//follow the allocator of global_memory_account.
+	void SetLibraryAllocator(const MemoryAllocator* allocator);
+	//SheenBidi bytes this engine keeps between edits. Past it paragraphs drop
+	//their bidi objects after layout and solve them again on the next one.
+	void SetLibraryLimit(size_t bytes);
+	//Bytes allocated by this engine, glyphs and atlases are in FontCollection::GetMemoryStats
+	MemoryStats GetMemoryStats();
+};
+
+
+//Appends UTF-8 that arrives in chunks of any size, such as reads from a socket
+//or a pipe. A codepoint cut by the end of a chunk is finished by the next one
+//and the line breaks of the last paragraph carry on where the previous chunk
+//stopped. That paragraph is laid out when it closes, on Flush, or once it has
+//grown by APPENDER_LAYOUT_MIN codepoints and by its size at the last layout,
+//until then its newest codepoints have no glyphs. Edits made through the
+//engine in between are picked up by the next Write. Must not outlive the engine.
+class TextAppender {
+	friend class TextEngine;
+	TextEngine* te;
+	//Start of a sequence the last chunk did not finish
+	unsigned char partial[4];
+	size_t partial_len = 0;
+	//Paragraph the line breaker runs over and the codepoints it has seen
+	Paragraph* open = nullptr;
+	size_t open_index = 0;
+	size_t open_seen = 0;
+	//Engine generation after the appender's last write, open is only still
+	//the last paragraph while they match
+	uint64_t generation = 0;
+	LineBreaker lb;
+
+public:
+	TextAppender(TextEngine* te);
+	TextAppender(const TextAppender&) = delete;
+	TextAppender& operator=(const TextAppender&) = delete;
+	void Write(const char* utf8_str, size_t len);
+	//Lays out the codepoints written so far
+	void Flush();
+	//A sequence left unfinished becomes U+FFFD, then flushes
+	void End();
+	~TextAppender();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include "TraceRecorder.h"
+#include <atomic>
+#include "PipelineStats.h"
+
+TraceRecorder::TraceRecorder() :events(1024), origin(PipelineStatsNow()) {}
+
+
+void TraceRecorder::Add(const TraceEvent& e) {
+	this->events.Push(e);
+}
+
+
+void TraceRecorder::Clear() {
+	this->events.Clear();
+	this->origin = PipelineStatsNow();
+}
+
+
+void TraceRecorder::WriteJson(FILE* fp) const {
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (size_t i = 0;i < this->events.GetSize();++i) {
+		const TraceEvent& e = this->events.Get(i);
+		uint64_t ts = e.start > this->origin ? e.start - this->origin : 0;
+		fprintf(
+			fp,
+			"%s\n{\"name\":\"%s\",\"cat\":\"TextEngine\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+			i == 0 ? "" : ",",
+			e.name, e.tid, ts / 1000.0, e.dur / 1000.0
+		);
+		bool first = true;
+		if (e.paragraph != TRACE_NO_ARG) {
+			fprintf(fp, "\"paragraph\":%lld", static_cast<long long>(e.paragraph));
+			first = false;
+		}
+		if (e.codepoints != TRACE_NO_ARG)
+			fprintf(fp, "%s\"codepoints\":%lld", first ? "" : ",", static_cast<long long>(e.codepoints));
+		fprintf(fp, "}}");
+	}
+	fprintf(fp, "\n]}\n");
+}
+
+
+bool TraceRecorder::WriteJson(const char* path) const {
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+	this->WriteJson(fp);
+	fclose(fp);
+	return true;
+}
+
+
+#ifdef TEXT_ENGINE_TRACE
+
+thread_local TraceRecorder* current_trace_recorder = nullptr;
+
+
+uint32_t TraceThreadId() {
+	static std::atomic<uint32_t> next_tid(1);
+	thread_local uint32_t tid = next_tid++;
+	return tid;
+}
+
+
+TraceSpan::TraceSpan(const char* name, int64_t paragraph, int64_t codepoints)
+	:name(name), start(0), paragraph(paragraph), codepoints(codepoints) {
+	if (current_trace_recorder != nullptr)
+		this->start = PipelineStatsNow();
+}
+
+
+TraceSpan::~TraceSpan() {
+	if (current_trace_recorder == nullptr || this->start == 0)
+		return;
+	uint64_t end = PipelineStatsNow();
+	current_trace_recorder->Add(TraceEvent(
+		this->name,
+		this->start,
+		end - this->start,
+		TraceThreadId(),
+		this->paragraph,
+		this->codepoints
+	));
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+//Copyright (C) 2025 Hongyi Chen (BeanPieChen)
+//Licensed under the MIT License
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "Array.h"
+
+#define TRACE_NO_ARG -1
+
+struct TraceEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t dur;
+	uint32_t tid;
+	int64_t paragraph;
+	int64_t codepoints;
+
+	TraceEvent(
+		const char* name = nullptr,
+		uint64_t start = 0,
+		uint64_t dur = 0,
+		uint32_t tid = 0,
+		int64_t paragraph = TRACE_NO_ARG,
+		int64_t codepoints = TRACE_NO_ARG
+	) :name(name), start(start), dur(dur), tid(tid), paragraph(paragraph), codepoints(codepoints) {}
+};
+
+
+//Collects complete ("X") spans and writes them as Chrome/Perfetto trace-event
+//JSON. Attach it with TextEngine::SetTraceRecorder, spans are only recorded
+//while one of the engine's edit calls runs and only when built with
+//TEXT_ENGINE_TRACE.
+class TraceRecorder {
+	Array<TraceEvent> events;
+	uint64_t origin;
+
+public:
+	TraceRecorder();
+	void Add(const TraceEvent& e);
+	size_t GetEventNum() const {
+		return this->events.GetSize();
+	}
+	const TraceEvent& GetEvent(size_t index) const {
+		return this->events.Get(index);
+	}
+	void Clear();
+	void WriteJson(FILE* fp) const;
+	bool WriteJson(const char* path) const;
+};
+
+
+#ifdef TEXT_ENGINE_TRACE
+
+//Recorder of the edit running on this thread, null outside of an edit
+extern thread_local TraceRecorder* current_trace_recorder;
+uint32_t TraceThreadId();
+
+
+class TraceEditScope {
+	TraceRecorder* prev;
+
+public:
+	TraceEditScope(TraceRecorder* recorder) :prev(current_trace_recorder) {
+		if (recorder != nullptr)
+			current_trace_recorder = recorder;
+	}
+	~TraceEditScope() {
+		current_trace_recorder = this->prev;
+	}
+};
+
+
+class TraceSpan {
+	const char* name;
+	uint64_t start;
+	int64_t paragraph;
+	int64_t codepoints;
+
+public:
+	TraceSpan(const char* name, int64_t paragraph = TRACE_NO_ARG, int64_t codepoints = TRACE_NO_ARG);
+	~TraceSpan();
+};
+
+#define _TRACE_CONCAT(a,b) a##b
+#define TRACE_CONCAT(a,b) _TRACE_CONCAT(a,b)
+#define TRACE_EDIT_SCOPE(recorder) TraceEditScope TRACE_CONCAT(_trace_edit_,__LINE__)(recorder)
+#define TRACE_SPAN(...) TraceSpan TRACE_CONCAT(_trace_span_,__LINE__)(__VA_ARGS__)
+
+#else
+
+#define TRACE_EDIT_SCOPE(recorder)
+#define TRACE_SPAN(...)
+
+#endif
+
+#endif
@@ -1,40 +1,48 @@
 //Copyright (C) 2025 Hongyi Chen (BeanPieChen)
 //Licensed under the MIT License
 
-#include <cstdint>
+#include "UTF8Codec.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define UTF8_CODEC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UTF8_TARGET(isa)
+#else
+#define UTF8_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
 
 int UTF8Encode(uint32_t codepoint, unsigned char ret[4]) {
-	uint32_t temp = codepoint;
-	for (int i = 0; i < 3; i++) {
-		temp >>= 8;
-		if (temp == 0) {
-			if (i == 0) {
-				ret[0] = codepoint;
-				return 1;
-			}
-			else {
-				ret[0] = 0x80u;
-				for (int j = i + 1; j >= 0; j--) {
-					if (j == 0) {
-						ret[0] |= codepoint;
-					}
-					else {
-						ret[j] = (0x80u | (codepoint & 0x3fu));
-						codepoint >>= 6;
-						ret[0] >>= 1;
-						ret[0] |= 0x80u;
-					}
-				}
-				return i + 2;
-			}
-		}
+	if (codepoint <= 0x7fu) {
+		ret[0] = codepoint;
+		return 1;
+	}
+	if (codepoint <= 0x7ffu) {
+		ret[0] = 0xc0u | (codepoint >> 6);
+		ret[1] = 0x80u | (codepoint & 0x3fu);
+		return 2;
+	}
+	if (codepoint <= 0xffffu) {
+		ret[0] = 0xe0u | (codepoint >> 12);
+		ret[1] = 0x80u | ((codepoint >> 6) & 0x3fu);
+		ret[2] = 0x80u | (codepoint & 0x3fu);
+		return 3;
+	}
+	if (codepoint <= 0x10ffffu) {
+		ret[0] = 0xf0u | (codepoint >> 18);
+		ret[1] = 0x80u | ((codepoint >> 12) & 0x3fu);
+		ret[2] = 0x80u | ((codepoint >> 6) & 0x3fu);
+		ret[3] = 0x80u | (codepoint & 0x3fu);
+		return 4;
 	}
-
 	return 0;
 }
 
 
-
 int UTF8Decode(const unsigned char* utf8_str, int offset, int len, uint32_t& codepoint) {
 	if (utf8_str[offset] <= 0x7fu) {
 		codepoint = utf8_str[offset];
@@ -68,4 +76,599 @@ int UTF8Decode(const unsigned char* utf8_str, int offset, int len, uint32_t& cod
 		codepoint = ret;
 		return byte_num;
 	}
-}
\ No newline at end of file
+}
+
+
+//Decodes the sequence at offset, a maximal invalid subpart becomes
+//UTF8_REPLACEMENT_CHAR. Returns the bytes used.
+inline size_t UTF8DecodeOne(const unsigned char* utf8_str, size_t offset, size_t len, uint32_t& codepoint) {
+	unsigned char lead = utf8_str[offset];
+	if (lead <= 0x7fu) {
+		codepoint = lead;
+		return 1;
+	}
+	//Range of the second byte, narrower after E0, ED, F0 and F4 so overlong
+	//forms, surrogates and values past U+10FFFF are rejected
+	unsigned char lo = 0x80u;
+	unsigned char hi = 0xbfu;
+	size_t byte_num;
+	uint32_t ret;
+	if (lead >= 0xc2u && lead <= 0xdfu) {
+		byte_num = 2;
+		ret = lead & 0x1fu;
+	}
+	else if (lead >= 0xe0u && lead <= 0xefu) {
+		byte_num = 3;
+		ret = lead & 0x0fu;
+		if (lead == 0xe0u)
+			lo = 0xa0u;
+		else if (lead == 0xedu)
+			hi = 0x9fu;
+	}
+	else if (lead >= 0xf0u && lead <= 0xf4u) {
+		byte_num = 4;
+		ret = lead & 0x07u;
+		if (lead == 0xf0u)
+			lo = 0x90u;
+		else if (lead == 0xf4u)
+			hi = 0x8fu;
+	}
+	else {
+		codepoint = UTF8_REPLACEMENT_CHAR;
+		return 1;
+	}
+	for (size_t i = 1;i < byte_num;++i) {
+		if (offset + i >= len || utf8_str[offset + i] < lo || utf8_str[offset + i] > hi) {
+			codepoint = UTF8_REPLACEMENT_CHAR;
+			return i;
+		}
+		ret = (ret << 6) | (utf8_str[offset + i] & 0x3fu);
+		lo = 0x80u;
+		hi = 0xbfu;
+	}
+	codepoint = ret;
+	return byte_num;
+}
+
+
+//Eight ASCII bytes at a time in a 64 bit word. Sequences starting in a word
+//with other bytes are decoded one by one, a block never yields more
+//codepoints than it has bytes.
+size_t UTF8DecodeScalar(const unsigned char* utf8_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps) {
+		if (len - i >= 8 && max_cps - n >= 8) {
+			uint64_t word;
+			memcpy(&word, utf8_str + i, 8);
+			if ((word & 0x8080808080808080ULL) == 0) {
+				for (size_t k = 0;k < 8;++k)
+					codepoints[n + k] = utf8_str[i + k];
+				i += 8;
+				n += 8;
+				continue;
+			}
+			size_t end = i + 8;
+			while (i < end)
+				i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+			continue;
+		}
+		i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+	}
+	consumed = i;
+	return n;
+}
+
+
+//Decodes the unit at offset and its low surrogate if it is a high one.
+//Returns the units used.
+inline size_t UTF16DecodeOne(const uint16_t* utf16_str, size_t offset, size_t len, uint32_t& codepoint) {
+	uint32_t unit = utf16_str[offset];
+	if (unit < 0xd800u || unit > 0xdfffu) {
+		codepoint = unit;
+		return 1;
+	}
+	if (unit <= 0xdbffu && offset + 1 < len) {
+		uint32_t low = utf16_str[offset + 1];
+		if (low >= 0xdc00u && low <= 0xdfffu) {
+			codepoint = 0x10000u + ((unit - 0xd800u) << 10) + (low - 0xdc00u);
+			return 2;
+		}
+	}
+	codepoint = UTF8_REPLACEMENT_CHAR;
+	return 1;
+}
+
+
+size_t UTF16DecodeScalar(const uint16_t* utf16_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps)
+		i += UTF16DecodeOne(utf16_str, i, len, codepoints[n++]);
+	consumed = i;
+	return n;
+}
+
+
+//Surrogates and values past U+10FFFF become UTF8_REPLACEMENT_CHAR
+inline size_t UTF8EncodeOne(uint32_t codepoint, unsigned char* utf8_str) {
+	if (codepoint <= 0x7fu) {
+		utf8_str[0] = static_cast<unsigned char>(codepoint);
+		return 1;
+	}
+	if (codepoint <= 0x7ffu) {
+		utf8_str[0] = static_cast<unsigned char>(0xc0u | (codepoint >> 6));
+		utf8_str[1] = static_cast<unsigned char>(0x80u | (codepoint & 0x3fu));
+		return 2;
+	}
+	if (codepoint > 0xffffu && codepoint <= 0x10ffffu) {
+		utf8_str[0] = static_cast<unsigned char>(0xf0u | (codepoint >> 18));
+		utf8_str[1] = static_cast<unsigned char>(0x80u | ((codepoint >> 12) & 0x3fu));
+		utf8_str[2] = static_cast<unsigned char>(0x80u | ((codepoint >> 6) & 0x3fu));
+		utf8_str[3] = static_cast<unsigned char>(0x80u | (codepoint & 0x3fu));
+		return 4;
+	}
+	if ((codepoint >= 0xd800u && codepoint <= 0xdfffu) || codepoint > 0x10ffffu)
+		codepoint = UTF8_REPLACEMENT_CHAR;
+	utf8_str[0] = static_cast<unsigned char>(0xe0u | (codepoint >> 12));
+	utf8_str[1] = static_cast<unsigned char>(0x80u | ((codepoint >> 6) & 0x3fu));
+	utf8_str[2] = static_cast<unsigned char>(0x80u | (codepoint & 0x3fu));
+	return 3;
+}
+
+
+//Eight ASCII codepoints at a time checked in four 64 bit words, a block with
+//others is encoded one by one. The blocks only run with room for eight four
+//byte sequences, so just the codepoints after them check the space left.
+size_t UTF8EncodeScalar(const uint32_t* codepoints, size_t n, unsigned char* utf8_str, size_t max_len, size_t& consumed) {
+	size_t i = 0;
+	size_t j = 0;
+	while (i < n) {
+		if (n - i >= 8 && max_len - j >= 32) {
+			uint64_t words[4];
+			memcpy(words, codepoints + i, 32);
+			if (((words[0] | words[1] | words[2] | words[3]) & 0xffffff80ffffff80ULL) == 0) {
+				for (size_t k = 0;k < 8;++k)
+					utf8_str[j + k] = static_cast<unsigned char>(codepoints[i + k]);
+				i += 8;
+				j += 8;
+				continue;
+			}
+			size_t end = i + 8;
+			while (i < end)
+				j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+			continue;
+		}
+		if (max_len - j < 4 && UTF8EncodedSize(codepoints[i]) > max_len - j)
+			break;
+		j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+	}
+	consumed = i;
+	return j;
+}
+
+
+//Branch free sum of UTF8EncodedSize
+size_t UTF8EncodedLengthScalar(const uint32_t* codepoints, size_t n) {
+	size_t len = n;
+	for (size_t i = 0;i < n;++i) {
+		uint32_t codepoint = codepoints[i];
+		len += (codepoint >= 0x80u) + (codepoint >= 0x800u) + (codepoint >= 0x10000u && codepoint <= 0x10ffffu);
+	}
+	return len;
+}
+
+
+#ifdef UTF8_CODEC_X86
+inline int UTF8CountTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+	unsigned long ret;
+	_BitScanForward(&ret, mask);
+	return static_cast<int>(ret);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+
+//Blocks of 16 bytes, all ASCII ones are widened with four stores. Otherwise
+//the ASCII prefix is copied and the sequences starting in the block are
+//decoded one by one.
+UTF8_TARGET("sse4.1")
+size_t UTF8DecodeSSE41(const unsigned char* utf8_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps) {
+		if (len - i >= 16 && max_cps - n >= 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8_str + i));
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+			if (mask == 0) {
+				__m128i* dst = reinterpret_cast<__m128i*>(codepoints + n);
+				_mm_storeu_si128(dst, _mm_cvtepu8_epi32(bytes));
+				_mm_storeu_si128(dst + 1, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+				_mm_storeu_si128(dst + 2, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+				_mm_storeu_si128(dst + 3, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)));
+				i += 16;
+				n += 16;
+				continue;
+			}
+			size_t end = i + 16;
+			int ascii = UTF8CountTrailingZeros(mask);
+			for (int k = 0;k < ascii;++k)
+				codepoints[n++] = utf8_str[i++];
+			while (i < end)
+				i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+			continue;
+		}
+		i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+	}
+	consumed = i;
+	return n;
+}
+
+
+//Same as UTF8DecodeSSE41 with blocks of 32 bytes
+UTF8_TARGET("avx2")
+size_t UTF8DecodeAVX2(const unsigned char* utf8_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps) {
+		if (len - i >= 32 && max_cps - n >= 32) {
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(utf8_str + i));
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+			if (mask == 0) {
+				__m128i lo = _mm256_castsi256_si128(bytes);
+				__m128i hi = _mm256_extracti128_si256(bytes, 1);
+				__m256i* dst = reinterpret_cast<__m256i*>(codepoints + n);
+				_mm256_storeu_si256(dst, _mm256_cvtepu8_epi32(lo));
+				_mm256_storeu_si256(dst + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+				_mm256_storeu_si256(dst + 2, _mm256_cvtepu8_epi32(hi));
+				_mm256_storeu_si256(dst + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+				i += 32;
+				n += 32;
+				continue;
+			}
+			size_t end = i + 32;
+			int ascii = UTF8CountTrailingZeros(mask);
+			for (int k = 0;k < ascii;++k)
+				codepoints[n++] = utf8_str[i++];
+			while (i < end)
+				i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+			continue;
+		}
+		i += UTF8DecodeOne(utf8_str, i, len, codepoints[n++]);
+	}
+	consumed = i;
+	return n;
+}
+
+
+//Blocks of 8 units, ones without surrogates are widened with two stores.
+//Otherwise the units before the first surrogate are copied and the rest of
+//the block is decoded one by one.
+UTF8_TARGET("sse4.1")
+size_t UTF16DecodeSSE41(const uint16_t* utf16_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	const __m128i surrogate_mask = _mm_set1_epi16(static_cast<short>(0xf800u));
+	const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xd800u));
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps) {
+		if (len - i >= 8 && max_cps - n >= 8) {
+			__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf16_str + i));
+			__m128i is_surrogate = _mm_cmpeq_epi16(_mm_and_si128(units, surrogate_mask), surrogate);
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(is_surrogate));
+			if (mask == 0) {
+				__m128i* dst = reinterpret_cast<__m128i*>(codepoints + n);
+				_mm_storeu_si128(dst, _mm_cvtepu16_epi32(units));
+				_mm_storeu_si128(dst + 1, _mm_cvtepu16_epi32(_mm_srli_si128(units, 8)));
+				i += 8;
+				n += 8;
+				continue;
+			}
+			size_t end = i + 8;
+			int plain = UTF8CountTrailingZeros(mask) / 2;
+			for (int k = 0;k < plain;++k)
+				codepoints[n++] = utf16_str[i++];
+			while (i < end)
+				i += UTF16DecodeOne(utf16_str, i, len, codepoints[n++]);
+			continue;
+		}
+		i += UTF16DecodeOne(utf16_str, i, len, codepoints[n++]);
+	}
+	consumed = i;
+	return n;
+}
+
+
+//Same as UTF16DecodeSSE41 with blocks of 16 units
+UTF8_TARGET("avx2")
+size_t UTF16DecodeAVX2(const uint16_t* utf16_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+	const __m256i surrogate_mask = _mm256_set1_epi16(static_cast<short>(0xf800u));
+	const __m256i surrogate = _mm256_set1_epi16(static_cast<short>(0xd800u));
+	size_t i = 0;
+	size_t n = 0;
+	while (i < len && n < max_cps) {
+		if (len - i >= 16 && max_cps - n >= 16) {
+			__m256i units = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(utf16_str + i));
+			__m256i is_surrogate = _mm256_cmpeq_epi16(_mm256_and_si256(units, surrogate_mask), surrogate);
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(is_surrogate));
+			if (mask == 0) {
+				__m256i* dst = reinterpret_cast<__m256i*>(codepoints + n);
+				_mm256_storeu_si256(dst, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(units)));
+				_mm256_storeu_si256(dst + 1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(units, 1)));
+				i += 16;
+				n += 16;
+				continue;
+			}
+			size_t end = i + 16;
+			int plain = UTF8CountTrailingZeros(mask) / 2;
+			for (int k = 0;k < plain;++k)
+				codepoints[n++] = utf16_str[i++];
+			while (i < end)
+				i += UTF16DecodeOne(utf16_str, i, len, codepoints[n++]);
+			continue;
+		}
+		i += UTF16DecodeOne(utf16_str, i, len, codepoints[n++]);
+	}
+	consumed = i;
+	return n;
+}
+
+
+//Blocks of 16 codepoints, all ASCII ones are narrowed with two packs into a
+//single store
+UTF8_TARGET("sse4.1")
+size_t UTF8EncodeSSE41(const uint32_t* codepoints, size_t n, unsigned char* utf8_str, size_t max_len, size_t& consumed) {
+	size_t i = 0;
+	size_t j = 0;
+	const __m128i high = _mm_set1_epi32(~0x7f);
+	while (i < n) {
+		if (n - i >= 16 && max_len - j >= 64) {
+			const __m128i* src = reinterpret_cast<const __m128i*>(codepoints + i);
+			__m128i a = _mm_loadu_si128(src);
+			__m128i b = _mm_loadu_si128(src + 1);
+			__m128i c = _mm_loadu_si128(src + 2);
+			__m128i d = _mm_loadu_si128(src + 3);
+			if (_mm_testz_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high)) {
+				__m128i bytes = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(utf8_str + j), bytes);
+				i += 16;
+				j += 16;
+				continue;
+			}
+			size_t end = i + 16;
+			while (i < end)
+				j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+			continue;
+		}
+		if (max_len - j < 4 && UTF8EncodedSize(codepoints[i]) > max_len - j)
+			break;
+		j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+	}
+	consumed = i;
+	return j;
+}
+
+
+//Same as UTF8EncodeSSE41 with blocks of 32 codepoints, the packs work per 128
+//bit lane so a permute puts the bytes back in order
+UTF8_TARGET("avx2")
+size_t UTF8EncodeAVX2(const uint32_t* codepoints, size_t n, unsigned char* utf8_str, size_t max_len, size_t& consumed) {
+	size_t i = 0;
+	size_t j = 0;
+	const __m256i high = _mm256_set1_epi32(~0x7f);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	while (i < n) {
+		if (n - i >= 32 && max_len - j >= 128) {
+			const __m256i* src = reinterpret_cast<const __m256i*>(codepoints + i);
+			__m256i a = _mm256_loadu_si256(src);
+			__m256i b = _mm256_loadu_si256(src + 1);
+			__m256i c = _mm256_loadu_si256(src + 2);
+			__m256i d = _mm256_loadu_si256(src + 3);
+			if (_mm256_testz_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)), high)) {
+				__m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+				bytes = _mm256_permutevar8x32_epi32(bytes, order);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(utf8_str + j), bytes);
+				i += 32;
+				j += 32;
+				continue;
+			}
+			size_t end = i + 32;
+			while (i < end)
+				j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+			continue;
+		}
+		if (max_len - j < 4 && UTF8EncodedSize(codepoints[i]) > max_len - j)
+			break;
+		j += UTF8EncodeOne(codepoints[i++], utf8_str + j);
+	}
+	consumed = i;
+	return j;
+}
+
+
+//Vectors of codepoints per flush of the 32 bit lane counters
+#define UTF8_LENGTH_BATCH	65536
+
+
+//Each lane counts 1 plus one for every bound its codepoint reaches, the four
+//byte bound only below U+110000 as larger values are replaced
+UTF8_TARGET("sse4.1")
+size_t UTF8EncodedLengthSSE41(const uint32_t* codepoints, size_t n) {
+	const __m128i b2 = _mm_set1_epi32(0x80);
+	const __m128i b3 = _mm_set1_epi32(0x800);
+	const __m128i b4 = _mm_set1_epi32(0x10000);
+	const __m128i b5 = _mm_set1_epi32(0x110000);
+	size_t len = 0;
+	size_t i = 0;
+	while (n - i >= 4) {
+		__m128i acc = _mm_setzero_si128();
+		for (size_t k = 0;k < UTF8_LENGTH_BATCH && n - i >= 4;++k, i += 4) {
+			__m128i cp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codepoints + i));
+			acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_max_epu32(cp, b2), cp));
+			acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_max_epu32(cp, b3), cp));
+			__m128i four = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_max_epu32(cp, b5), cp), _mm_cmpeq_epi32(_mm_max_epu32(cp, b4), cp));
+			acc = _mm_sub_epi32(acc, four);
+		}
+		uint32_t lanes[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+		len += static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+	}
+	return len + i + UTF8EncodedLengthScalar(codepoints + i, n - i);
+}
+
+
+UTF8_TARGET("avx2")
+size_t UTF8EncodedLengthAVX2(const uint32_t* codepoints, size_t n) {
+	const __m256i b2 = _mm256_set1_epi32(0x80);
+	const __m256i b3 = _mm256_set1_epi32(0x800);
+	const __m256i b4 = _mm256_set1_epi32(0x10000);
+	const __m256i b5 = _mm256_set1_epi32(0x110000);
+	size_t len = 0;
+	size_t i = 0;
+	while (n - i >= 8) {
+		__m256i acc = _mm256_setzero_si256();
+		for (size_t k = 0;k < UTF8_LENGTH_BATCH && n - i >= 8;++k, i += 8) {
+			__m256i cp = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codepoints + i));
+			acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_max_epu32(cp, b2), cp));
+			acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_max_epu32(cp, b3), cp));
+			__m256i four = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(cp, b5), cp), _mm256_cmpeq_epi32(_mm256_max_epu32(cp, b4), cp));
+			acc = _mm256_sub_epi32(acc, four);
+		}
+		uint32_t lanes[8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+		for (int k = 0;k < 8;++k)
+			len += lanes[k];
+	}
+	return len + i + UTF8EncodedLengthScalar(codepoints + i, n - i);
+}
+
+
+int UTF8DetectSimdLevel() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+	bool avx2 = false;
+	if (max_leaf >= 7 && os_avx) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool sse41 = __builtin_cpu_supports("sse4.1");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	if (avx2)
+		return UTF8_SIMD_AVX2;
+	if (sse41)
+		return UTF8_SIMD_SSE41;
+	return UTF8_SIMD_NONE;
+}
+#else
+int UTF8DetectSimdLevel() {
+	return UTF8_SIMD_NONE;
+}
+#endif
+
+
+int UTF8GetSupportedSimdLevel() {
+	static int level = UTF8DetectSimdLevel();
+	return level;
+}
+
+
+//Lowered by UTF8SetSimdLevel, the supported level caps it anyway
+int utf8_simd_level = UTF8_SIMD_AVX2;
+
+
+size_t UTF8DecodeRange(const unsigned char* utf8_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+#ifdef UTF8_CODEC_X86
+	switch (UTF8GetSimdLevel()) {
+	case UTF8_SIMD_AVX2:
+		return UTF8DecodeAVX2(utf8_str, len, codepoints, max_cps, consumed);
+	case UTF8_SIMD_SSE41:
+		return UTF8DecodeSSE41(utf8_str, len, codepoints, max_cps, consumed);
+	}
+#endif
+	return UTF8DecodeScalar(utf8_str, len, codepoints, max_cps, consumed);
+}
+
+
+size_t UTF16DecodeRange(const uint16_t* utf16_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed) {
+#ifdef UTF8_CODEC_X86
+	switch (UTF8GetSimdLevel()) {
+	case UTF8_SIMD_AVX2:
+		return UTF16DecodeAVX2(utf16_str, len, codepoints, max_cps, consumed);
+	case UTF8_SIMD_SSE41:
+		return UTF16DecodeSSE41(utf16_str, len, codepoints, max_cps, consumed);
+	}
+#endif
+	return UTF16DecodeScalar(utf16_str, len, codepoints, max_cps, consumed);
+}
+
+
+size_t UTF8EncodeRange(const uint32_t* codepoints, size_t n, unsigned char* utf8_str, size_t max_len, size_t& consumed) {
+#ifdef UTF8_CODEC_X86
+	switch (UTF8GetSimdLevel()) {
+	case UTF8_SIMD_AVX2:
+		return UTF8EncodeAVX2(codepoints, n, utf8_str, max_len, consumed);
+	case UTF8_SIMD_SSE41:
+		return UTF8EncodeSSE41(codepoints, n, utf8_str, max_len, consumed);
+	}
+#endif
+	return UTF8EncodeScalar(codepoints, n, utf8_str, max_len, consumed);
+}
+
+
+size_t UTF8EncodedLength(const uint32_t* codepoints, size_t n) {
+#ifdef UTF8_CODEC_X86
+	switch (UTF8GetSimdLevel()) {
+	case UTF8_SIMD_AVX2:
+		return UTF8EncodedLengthAVX2(codepoints, n);
+	case UTF8_SIMD_SSE41:
+		return UTF8EncodedLengthSSE41(codepoints, n);
+	}
+#endif
+	return UTF8EncodedLengthScalar(codepoints, n);
+}
+
+
+size_t UTF8IncompleteTail(const unsigned char* utf8_str, size_t len) {
+	size_t start = len > 3 ? len - 3 : 0;
+	for (size_t offset = len;offset > start;) {
+		--offset;
+		unsigned char lead = utf8_str[offset];
+		if ((lead & 0xc0u) == 0x80u)
+			continue;
+		size_t byte_num = 0;
+		if (lead >= 0xc2u && lead <= 0xdfu)
+			byte_num = 2;
+		else if (lead >= 0xe0u && lead <= 0xefu)
+			byte_num = 3;
+		else if (lead >= 0xf0u && lead <= 0xf4u)
+			byte_num = 4;
+		size_t tail = len - offset;
+		if (byte_num <= tail)
+			return 0;
+		//Cut by len only if every byte after the lead is accepted
+		uint32_t codepoint;
+		return UTF8DecodeOne(utf8_str, offset, len, codepoint) == tail ? tail : 0;
+	}
+	return 0;
+}
+
+
+int UTF8GetSimdLevel() {
+	int supported = UTF8GetSupportedSimdLevel();
+	return utf8_simd_level < supported ? utf8_simd_level : supported;
+}
+
+
+int UTF8SetSimdLevel(int level) {
+	utf8_simd_level = level;
+	return UTF8GetSimdLevel();
+}
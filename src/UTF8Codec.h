@@ -4,9 +4,54 @@
 //Copyright (C) 2025 Hongyi Chen (BeanPieChen)
 //Licensed under the MIT License
 
+#include<cstddef>
 #include<cstdint>
 
+#define UTF8_REPLACEMENT_CHAR	0xFFFDu
+
+#define UTF8_SIMD_NONE		0
+#define UTF8_SIMD_SSE41		1
+#define UTF8_SIMD_AVX2		2
+
 int UTF8Encode(uint32_t codepoint, unsigned char utf8_code[4]);
+//Bytes codepoint encodes to, a replaced one takes the three of
+//UTF8_REPLACEMENT_CHAR
+inline size_t UTF8EncodedSize(uint32_t codepoint) {
+	if (codepoint <= 0x7fu)
+		return 1;
+	if (codepoint <= 0x7ffu)
+		return 2;
+	if (codepoint <= 0xffffu || codepoint > 0x10ffffu)
+		return 3;
+	return 4;
+}
 int UTF8Decode(const unsigned char* utf8_str, int offset, int len, uint32_t& codepoint);
 
-#endif
\ No newline at end of file
+//Decodes utf8_str until len bytes are used or max_cps codepoints are written,
+//consumed is set to the bytes used. Ill-formed sequences decode to
+//UTF8_REPLACEMENT_CHAR, one for each maximal invalid subpart.
+size_t UTF8DecodeRange(const unsigned char* utf8_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed);
+//Encodes codepoints until n are used or the next one does not fit in max_len
+//bytes, consumed is set to the codepoints used. Returns the bytes written.
+//Surrogates and values past U+10FFFF encode to UTF8_REPLACEMENT_CHAR.
+size_t UTF8EncodeRange(const uint32_t* codepoints, size_t n, unsigned char* utf8_str, size_t max_len, size_t& consumed);
+//Bytes UTF8EncodeRange writes for codepoints
+size_t UTF8EncodedLength(const uint32_t* codepoints, size_t n);
+//UTF-16 counterpart of UTF8DecodeRange, consumed counts 16 bit units. A
+//surrogate without its pair decodes to UTF8_REPLACEMENT_CHAR.
+size_t UTF16DecodeRange(const uint16_t* utf16_str, size_t len, uint32_t* codepoints, size_t max_cps, size_t& consumed);
+//Surrogates and values past U+10FFFF of a UTF-32 buffer become
+//UTF8_REPLACEMENT_CHAR
+inline uint32_t UTF32Sanitize(uint32_t codepoint) {
+	return (codepoint >= 0xd800u && codepoint <= 0xdfffu) || codepoint > 0x10ffffu ? UTF8_REPLACEMENT_CHAR : codepoint;
+}
+//Bytes at the end of utf8_str that start a valid sequence without finishing
+//it, a streaming decoder keeps them for the next chunk
+size_t UTF8IncompleteTail(const unsigned char* utf8_str, size_t len);
+//Instruction set used by the range functions, the best one of this CPU by default
+int UTF8GetSimdLevel();
+//Caps the instruction set for the whole process, for benchmarks. Returns the
+//level in effect.
+int UTF8SetSimdLevel(int level);
+
+#endif
@@ -45,7 +45,7 @@ uint8_t MapFirst(uint8_t c) {
 
 
 uint32_t LineBreaker::NextCodePoint() {
-    const uint32_t code = this->at_f(this->cps, this->i);
+    const uint32_t code = this->at_f != nullptr ? this->at_f(this->cps, this->i) : static_cast<const uint32_t*>(this->cps)[this->i];
     ++this->i;
     return code;
 }
@@ -192,6 +192,11 @@ bool LineBreaker::NextBreak(Break& ret) {
 }
 
 
+void LineBreaker::Extend(size_t len) {
+    this->len = len;
+}
+
+
 void LineBreakInit() {
     tinf_init();
     class_trie = new UnicodeTrie(classes_trie_data);
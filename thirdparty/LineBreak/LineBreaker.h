@@ -33,8 +33,11 @@ public:
         bool required = false;
     };
 
+    // at_f may be nullptr when cps is a plain uint32_t buffer
     LineBreaker(const void* cps, size_t len, CodepointAt at_f);
     bool NextBreak(Break& ret);
+    // Carries on over cps grown to len, the codepoints seen so far must not change
+    void Extend(size_t len);
 };
 
 
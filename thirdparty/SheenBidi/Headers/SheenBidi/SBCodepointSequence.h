@@ -25,7 +25,7 @@ SB_EXTERN_C_BEGIN
 typedef SBCodepoint(*SBCodepointAt)(const void* codepoints, SBUInteger index);
 
 typedef struct _SBCodepointSequence {
-    SBCodepointAt codepointAt;
+    SBCodepointAt codepointAt;     /**< NULL if codepoints is a plain array of SBUInt32. */
     const void *codepoints;        /**< The source string containing the code units. */
     SBUInteger length;         /**< The length of the string in terms of code units. */
 } SBCodepointSequence;
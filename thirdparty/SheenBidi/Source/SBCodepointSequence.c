@@ -35,7 +35,10 @@ SBCodepoint SBCodepointSequenceGetCodepointAt(const SBCodepointSequence *codepoi
     if (*stringIndex < codepointSequence->length) {
         const SBUInt32 *codepoints = codepointSequence->codepoints;
 
-        codepoint = codepointSequence->codepointAt(codepoints, *stringIndex);
+        if (codepointSequence->codepointAt)
+            codepoint = codepointSequence->codepointAt(codepoints, *stringIndex);
+        else
+            codepoint = codepoints[*stringIndex];
         *stringIndex += 1;
 
         if (!SBCodepointIsValid(codepoint)) {